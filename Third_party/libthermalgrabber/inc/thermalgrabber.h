@@ -4,6 +4,8 @@
 #define LOG
 
 #include <inttypes.h>
+#include <vector>
+#include <chrono>
 
 //! Container for raw tau bitmap.
 /*!
@@ -49,6 +51,18 @@ public:
      */
     unsigned int pps_timestamp;
 
+    //! Arrival time of the first USB payload of the frame.
+    /*!
+     * Host time (steady clock), to measure the latency of the pipeline.
+     */
+    std::chrono::steady_clock::time_point usbTime;
+
+    //! Time at which the decoding of the frame was done.
+    /*!
+     * Host time (steady clock), just before the callback is called.
+     */
+    std::chrono::steady_clock::time_point decodedTime;
+
     //! Array of raw pixel values.
     /*!
     *   The raw pixel values (14 bit) are stored in a 16 bit array.
@@ -138,8 +152,60 @@ enum TriggerMode{
     slave,
     master,
 };
+
+//! Options of the USB stream of the grabber.
+/*!
+*   The default values are the ones used by the constructors without options.
+*   All the transfer buffers are allocated in one page-aligned block
+*   (DMA-able memory when libusb supports it), limited to 1 MiB per grabber:
+*   fewer transfers are queued when the transfers are large.
+*   In adaptive mode, the transfers start with packetsPerTransfer packets and
+*   are resized from the measured data rate, so that a transfer is filled in
+*   about targetTransferTimeUs. This keeps the number of wake-ups of the USB
+*   thread low at high rates, without delaying the data at low rates.
+*/
+struct StreamOptions
+{
+    //! Size of a USB transfer, in 512 bytes packets (initial size in adaptive mode).
+    unsigned int packetsPerTransfer = 8;
+
+    //! Maximum number of transfers queued at the same time (reduced to keep the buffers within 1 MiB).
+    unsigned int numTransfers = 256;
+
+    //! Timeout of the USB event loop, in microseconds.
+    unsigned int eventTimeoutUs = 10000;
+
+    //! Resize the transfers from the measured data rate.
+    bool adaptive = false;
+
+    //! Adaptive mode: minimum size of a transfer, in packets.
+    unsigned int minPacketsPerTransfer = 4;
+
+    //! Adaptive mode: maximum size of a transfer, in packets (gives the size of the buffers).
+    unsigned int maxPacketsPerTransfer = 64;
+
+    //! Adaptive mode: time to fill a transfer at the measured rate, in microseconds.
+    unsigned int targetTransferTimeUs = 2000;
+};
+
+//! Scheduling of a thread of the grabber.
+/*!
+*   By default, the thread is left to the scheduler.
+*   Only supported on Linux. The real-time scheduling needs the
+*   CAP_SYS_NICE capability (or a suitable RLIMIT_RTPRIO).
+*/
+struct ThreadConfig
+{
+    //! Core on which the thread is pinned, negative to let the scheduler choose.
+    int cpu = -1;
+
+    //! Priority of the real-time scheduling (SCHED_FIFO, 1 to 99), 0 to keep the normal scheduling.
+    int rtPriority = 0;
+};
 }
 
+class TauInterface;
+
 //! Class for connecting "Thermal Capture Grabber USB".
 /*!
 *   Connecting Thermal Capture Grabber USB needs three steps:
@@ -155,6 +221,9 @@ class ThermalGrabber
 public:
 
     //! Type definition of callback.
+    /*!
+    *   The TauRawBitmap is reused for the next frame, it's only valid during the call.
+    */
     typedef void (*callbackThermalGrabber)(TauRawBitmap& tauRawBitmap, void* caller);
 
     //! Constructor of ThermalGrabber.
@@ -191,6 +260,18 @@ public:
      */
     ThermalGrabber(callbackThermalGrabber cb, void* caller, const char* iSerialUSB);
 
+    //! Constructor of ThermalGrabber.
+    /*!
+    *   Same as the constructor above, with the options of the USB stream.
+    *   The options are also used when the connection is reset.
+    *   \param cb Callback.
+    *   \param caller Calling instance.
+    *   \param iSerialUSB Char string representation of iSerial, NULL or empty to connect the first grabber found.
+    *   \param streamOptions Options of the USB stream.
+     */
+    ThermalGrabber(callbackThermalGrabber cb, void* caller, const char* iSerialUSB,
+                   const thermal_grabber::StreamOptions& streamOptions);
+
     //! Destructor of ThermalGrabber.
     /*!
     *   Cleans up the ThermalGrabber object memory and waits for
@@ -212,12 +293,23 @@ public:
     *   and an optional byte array of arguments (data) and
     *   a length info of the data (the function byte/cmd is not counted).
     *   If no additional data are send put a "NULL" for the 2. and "0" for the 3. parameter.
+    *   Returns once the tau core has replied to the command, or after a timeout.
     *   \param cmd The function that is called
     *   \param data Optional data bytes as arguments.
     *   \param data_len The length of the data field.
     */
     void sendCommand(char cmd, char *data, unsigned int data_len);
 
+    //! Set the scheduling of the threads of the grabber.
+    /*!
+    *   The configurations are applied to the running threads, and to the
+    *   threads started when the connection is reset.
+    *   \param usbEvents Configuration of the thread handling the USB transfers.
+    *   \param decoder Configuration of the thread decoding the frames.
+    *   \return False if a setting could not be applied.
+    */
+    bool setThreadConfig(const thermal_grabber::ThreadConfig& usbEvents, const thermal_grabber::ThreadConfig& decoder);
+
     //! Get the resolution width.
     /*!
      * Get the resolution width of the tau core that
@@ -273,6 +365,18 @@ public:
      */
     void setGainMode(thermal_grabber::GainMode gainMode);
     void setTriggerMode(thermal_grabber::TriggerMode triggerMode);
+
+    //! Set the region of interest
+    /*!
+     * Only this part of the frame is decoded and given in the TauRawBitmap
+     * (min and max are computed on this part). Applied from the next frame.
+     * An empty region gives the whole frame, a region exceeding the frame is cropped.
+     * \param x First column.
+     * \param y First row.
+     * \param width Width of the region, 0 for the whole frame.
+     * \param height Height of the region, 0 for the whole frame.
+     */
+    void setROI(unsigned int x, unsigned int y, unsigned int width, unsigned int height);
 //    thermal_grabber::TriggerMode getTriggerMode(thermal_grabber::TriggerMode triggerMode) const;
 
     //! Enables TLinear in high resolution
@@ -309,10 +413,16 @@ private:
     // internally used reference to callback and calling instance
     callbackThermalGrabber mCallbackThermalGrabber;
     void* mCallingInstance;
+
+    // connection to the grabber, owned by this instance
+    TauInterface* mTauInterface;
     bool opened;
 
     // internally used helper function for scaling color values.
     unsigned int scale(unsigned int value, unsigned int lowBound, unsigned int upBound , unsigned int minOutput, unsigned int maxOutput);
+
+    // scaled values of the last converted bitmap, indexed from its min (reused between frames)
+    std::vector<unsigned char> mRgbLut;
 };
 
 #endif // THERMALGRABBER_H
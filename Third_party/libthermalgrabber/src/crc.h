@@ -1,6 +1,7 @@
 #ifndef CRC_H
 #define CRC_H
 
-unsigned short calc_crc(unsigned char * data, int len);
+// CRC-CCITT of the Tau protocol frames (reentrant)
+unsigned short calc_crc(const unsigned char * data, int len);
 
 #endif // CRC_H
@@ -32,6 +32,12 @@
 #include <iostream>
 #include <thread>
 
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <unistd.h>
+#endif
+
 #ifdef _WIN32
 
 #include <Windows.h>
@@ -63,6 +69,7 @@ typedef struct {
     void *userdata;
     int result;
     FTDIProgressInfo progress;
+    int transferLength; // length of the next submitted transfers (adaptive mode)
 } FTDIStreamState;
 
 static int
@@ -837,6 +844,7 @@ ReadStreamCallback(struct libusb_transfer *transfer)
     }
 
     if (state->result == 0) {
+        transfer->length = state->transferLength;
         transfer->status = (libusb_transfer_status)-1;
         state->result = libusb_submit_transfer(transfer);
     }
@@ -853,6 +861,119 @@ TimevalDiff(const struct timeval *a, const struct timeval *b)
 }
 
 
+#ifndef USE_FTDI
+
+/*
+ * One page-aligned block for all the transfer buffers. libusb allocates it
+ * in DMA-able memory when it can (usbfs zero-copy, libusb >= 1.0.21),
+ * otherwise it is allocated here.
+ */
+
+static uint8_t*
+AllocTransferPool(FTDIDevice *dev, size_t size, bool *devMem)
+{
+    *devMem = false;
+
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+    uint8_t *devPool = libusb_dev_mem_alloc(dev->handle, size);
+    if (devPool) {
+        *devMem = true;
+        return devPool;
+    }
+#else
+    (void)dev;
+#endif
+
+#ifdef _WIN32
+    return (uint8_t*)_aligned_malloc(size, 4096);
+#else
+    void *pool = NULL;
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (posix_memalign(&pool, pageSize > 0 ? pageSize : 4096, size))
+        return NULL;
+    return (uint8_t*)pool;
+#endif
+}
+
+static void
+FreeTransferPool(FTDIDevice *dev, uint8_t *pool, size_t size, bool devMem)
+{
+    if (!pool)
+        return;
+
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+    if (devMem) {
+        libusb_dev_mem_free(dev->handle, pool, size);
+        return;
+    }
+#else
+    (void)dev;
+    (void)devMem;
+#endif
+    (void)size;
+
+#ifdef _WIN32
+    _aligned_free(pool);
+#else
+    free(pool);
+#endif
+}
+
+#endif
+
+
+/*
+ * Adaptive mode: number of packets needed to receive targetTransferTime
+ * seconds of data at the current rate, in bytes.
+ */
+
+int
+FTDIStreamOptions_AdaptiveTransferLength(const FTDIStreamOptions *options, double currentRate)
+{
+    const int payloadSize = FTDI_PACKET_SIZE - FTDI_HEADER_SIZE;
+    const double wanted = currentRate * options->targetTransferTime / payloadSize + 1;
+    int packets = wanted < options->maxPacketsPerTransfer ? (int)wanted : options->maxPacketsPerTransfer;
+
+    if (packets < options->minPacketsPerTransfer)
+        packets = options->minPacketsPerTransfer;
+
+    return packets * FTDI_PACKET_SIZE;
+}
+
+
+/*
+ * Number of transfers actually queued: numTransfers, limited so that the
+ * buffers (sized for the largest transfer) fit in FTDI_TRANSFER_POOL_SIZE.
+ */
+
+int
+FTDIStreamOptions_NumTransfers(const FTDIStreamOptions *options)
+{
+    const int maxPackets = options->adaptive ? options->maxPacketsPerTransfer : options->packetsPerTransfer;
+    if (maxPackets <= 0)
+        return options->numTransfers;
+
+    int budget = FTDI_TRANSFER_POOL_SIZE / (maxPackets * FTDI_PACKET_SIZE);
+    if (budget < FTDI_MIN_TRANSFERS)
+        budget = FTDI_MIN_TRANSFERS;
+
+    return options->numTransfers < budget ? options->numTransfers : budget;
+}
+
+
+void
+FTDIStreamOptions_Default(FTDIStreamOptions *options)
+{
+    options->packetsPerTransfer = 8;
+    options->numTransfers = 256;
+    options->eventTimeoutUs = 10000;
+    options->adaptive = false;
+    options->minPacketsPerTransfer = 4;
+    options->maxPacketsPerTransfer = 64;
+    options->targetTransferTime = 0.002;
+}
+
+
 /*
  * Use asynchronous transfers in libusb-1.0 for high-performance
  * streaming of data from a device interface back to the PC. This
@@ -869,9 +990,29 @@ FTDIDevice_ReadStream(FTDIDevice *dev, FTDIInterface interface,
                       FTDIStreamCallback *callback, void *userdata,
                       int packetsPerTransfer, int numTransfers)
 {
+    FTDIStreamOptions options;
+    FTDIStreamOptions_Default(&options);
+    options.packetsPerTransfer = packetsPerTransfer;
+    options.numTransfers = numTransfers;
+
+    return FTDIDevice_ReadStreamOptions(dev, interface, callback, userdata, &options);
+}
+
+
+/*
+ * Same as FTDIDevice_ReadStream, with the transfers configured by the options
+ * (see FTDIStreamOptions). The D2XX implementation only uses packetsPerTransfer.
+ */
+
+int
+FTDIDevice_ReadStreamOptions(FTDIDevice *dev, FTDIInterface interface,
+                             FTDIStreamCallback *callback, void *userdata,
+                             const FTDIStreamOptions *options)
+{
 
 #ifdef USE_FTDI
 
+    const int packetsPerTransfer = options->packetsPerTransfer;
     FT_STATUS ftStatus = FT_OK;
     DWORD RxBytes = packetsPerTransfer * FTDI_PACKET_SIZE; // ~256*512 -> 128kB
     char RxBuffer[packetsPerTransfer * FTDI_PACKET_SIZE];
@@ -976,18 +1117,31 @@ FTDIDevice_ReadStream(FTDIDevice *dev, FTDIInterface interface,
 
 #else
 
-    struct libusb_transfer **transfers;
+    struct libusb_transfer **transfers = NULL;
     FTDIStreamState state = { callback, userdata };
-    int bufferSize = packetsPerTransfer * FTDI_PACKET_SIZE;
+    const int numTransfers = FTDIStreamOptions_NumTransfers(options);
+    const int maxPackets = options->adaptive ? options->maxPacketsPerTransfer : options->packetsPerTransfer;
+    const int bufferSize = maxPackets * FTDI_PACKET_SIZE;
+    const size_t poolSize = (size_t)bufferSize * numTransfers;
+    uint8_t *pool = NULL;
+    bool poolDevMem = false;
     int xferIndex;
     int err = 0;
+
+    if (numTransfers <= 0 || options->packetsPerTransfer <= 0 || options->packetsPerTransfer > maxPackets ||
+        (options->adaptive && (options->minPacketsPerTransfer <= 0 || options->minPacketsPerTransfer > maxPackets)))
+        return LIBUSB_ERROR_INVALID_PARAM;
+
+    state.transferLength = options->packetsPerTransfer * FTDI_PACKET_SIZE;
 //std::cout << "----------------------> 1" << std::endl;
     /*
     * Set up all transfers
     */
     transfers = (libusb_transfer**)calloc(numTransfers, sizeof *transfers);
 
-    if (!transfers) {
+    pool = AllocTransferPool(dev, poolSize, &poolDevMem);
+
+    if (!transfers || !pool) {
         err = LIBUSB_ERROR_NO_MEM;
         goto cleanup;
     }
@@ -1004,13 +1158,8 @@ FTDIDevice_ReadStream(FTDIDevice *dev, FTDIInterface interface,
         }
 
         libusb_fill_bulk_transfer(transfer, dev->handle, FTDI_EP_IN(interface),
-                                  (unsigned char*)malloc(bufferSize), bufferSize, ReadStreamCallback,
-                                  &state, 0);
-
-        if (!transfer->buffer) {
-            err = LIBUSB_ERROR_NO_MEM;
-            goto cleanup;
-        }
+                                  pool + (size_t)xferIndex * bufferSize, state.transferLength,
+                                  ReadStreamCallback, &state, 0);
 
         transfer->status = (libusb_transfer_status)-1;
         err = libusb_submit_transfer(transfer);
@@ -1026,7 +1175,7 @@ FTDIDevice_ReadStream(FTDIDevice *dev, FTDIInterface interface,
     do {
         FTDIProgressInfo  *progress = &state.progress;
         const double progressInterval = 0.1;
-        struct timeval timeout = { 0, 10000 };
+        struct timeval timeout = { options->eventTimeoutUs / 1000000, options->eventTimeoutUs % 1000000 };
         struct timeval now;
 
         int err = libusb_handle_events_timeout(dev->libusb, &timeout);
@@ -1056,6 +1205,10 @@ FTDIDevice_ReadStream(FTDIDevice *dev, FTDIInterface interface,
                 progress->totalRate = progress->current.totalBytes / progress->totalTime;
                 progress->currentRate = (progress->current.totalBytes -
                                          progress->prev.totalBytes) / currentTime;
+
+                // Resubmitted transfers take the new length
+                if (options->adaptive && progress->currentRate > 0)
+                    state.transferLength = FTDIStreamOptions_AdaptiveTransferLength(options, progress->currentRate);
             }
 
             state.result = state.callback(NULL, 0, progress, state.userdata);
@@ -1090,7 +1243,6 @@ cleanup:
                         // If a transfer is complete or cancelled, nuke it
                     } else if (transfer->status == 0 ||
                                transfer->status == LIBUSB_TRANSFER_CANCELLED) {
-                        free(transfer->buffer);
                         libusb_free_transfer(transfer);
                         transfers[xferIndex] = NULL;
                     }
@@ -1104,6 +1256,9 @@ cleanup:
         free(transfers);
     }
 
+    // The buffers are only released once no transfer uses them
+    FreeTransferPool(dev, pool, poolSize, poolDevMem);
+
 
     if (err)
     {
@@ -120,10 +120,35 @@ typedef struct {
 #define FTDI_PACKET_SIZE          512   // Specific to FT2232H
 #define FTDI_LOG_PACKET_SIZE      9     // 512 == 1 << 9
 #define FTDI_HEADER_SIZE          2
+#define FTDI_TRANSFER_POOL_SIZE   (1 << 20) // Budget of the transfer buffers, in bytes (usbfs allows 16 MiB for all the devices)
+#define FTDI_MIN_TRANSFERS        4         // Transfers queued even when the budget is exceeded
 
 typedef int (FTDIStreamCallback)(uint8_t *buffer, int length,
                                  FTDIProgressInfo *progress, void *userdata);
 
+/*
+ * Options of the read stream.
+ *
+ * All the transfer buffers are taken from one page-aligned block, allocated
+ * in DMA-able memory by libusb when it supports it (zero-copy on Linux).
+ * The number of transfers is limited so that the buffers, sized for the
+ * largest transfer, fit in FTDI_TRANSFER_POOL_SIZE bytes.
+ * In adaptive mode, the transfers start with packetsPerTransfer packets and
+ * are resized from the measured data rate, so that a transfer is filled in
+ * about targetTransferTime seconds: a slow stream does not wait for large
+ * transfers, and a fast stream does not wake up the event loop for each
+ * small transfer.
+ */
+typedef struct {
+    int packetsPerTransfer;     // Size of a transfer, in packets (initial size in adaptive mode)
+    int numTransfers;           // Maximum number of transfers in flight (see FTDIStreamOptions_NumTransfers)
+    int eventTimeoutUs;         // Timeout of the event loop, in us
+    bool adaptive;              // Resize the transfers from the measured data rate
+    int minPacketsPerTransfer;  // Adaptive mode: limits of the transfer size, in packets
+    int maxPacketsPerTransfer;
+    double targetTransferTime;  // Adaptive mode: time to fill a transfer, in s
+} FTDIStreamOptions;
+
 /*
  * Public Functions
  */
@@ -147,6 +172,12 @@ int FTDIDevice_ReadByteSync(FTDIDevice *dev, FTDIInterface interface, uint8_t *b
 int FTDIDevice_ReadStream(FTDIDevice *dev, FTDIInterface interface,
                           FTDIStreamCallback *callback, void *userdata,
                           int packetsPerTransfer, int numTransfers);
+void FTDIStreamOptions_Default(FTDIStreamOptions *options);
+int FTDIStreamOptions_NumTransfers(const FTDIStreamOptions *options);
+int FTDIStreamOptions_AdaptiveTransferLength(const FTDIStreamOptions *options, double currentRate);
+int FTDIDevice_ReadStreamOptions(FTDIDevice *dev, FTDIInterface interface,
+                                 FTDIStreamCallback *callback, void *userdata,
+                                 const FTDIStreamOptions *options);
 
 int FTDIDevice_MPSSE_Enable(FTDIDevice *dev, FTDIInterface interface);
 int FTDIDevice_MPSSE_SetDivisor(FTDIDevice *dev, FTDIInterface interface,
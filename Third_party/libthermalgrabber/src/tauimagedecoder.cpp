@@ -1,8 +1,16 @@
 #include "tauimagedecoder.h"
 
+#include <algorithm>
 #include <iostream>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 TauRGBBitmap::TauRGBBitmap(unsigned int width, unsigned int height) : width(width), height(height)
 {
     if((this->width>0)&&(this->height>0))
@@ -54,32 +62,203 @@ TauRawBitmap::~TauRawBitmap()
         delete [] data;
 }
 
-TauImageDecoder::TauImageDecoder() : mTauCoreResWidth(0), mTauCoreResHeight(0)
+//
+//--- row decoding kernels ----------------------------------------------------
+//
+// A row is decoded in one pass : the sync bits are removed, the pixels are written
+// to the bitmap and the min/max of the row are computed.
+// The pixels are 14 bit values after the mask, so the signed 16 bit min/max of SSE2 are exact.
+
+typedef void (*DecodeRowFunction)(const uint16_t* src, uint16_t* dst, unsigned int count, uint16_t& minValue, uint16_t& maxValue);
+
+static void decodeRowScalar(const uint16_t* src, uint16_t* dst, unsigned int count, uint16_t& minValue, uint16_t& maxValue)
+{
+    uint16_t minV = minValue;
+    uint16_t maxV = maxValue;
+    for (unsigned int i=0; i<count; i++)
+    {
+        const uint16_t value = src[i] & 0x3fff; // remove first 2 bits with mask 0b0011 1111 1111 1111
+        dst[i] = value;
+        minV = std::min(minV, value);
+        maxV = std::max(maxV, value);
+    }
+    minValue = minV;
+    maxValue = maxV;
+}
+
+#if defined(__SSE2__)
+static void reduceMinMax(const uint16_t* mins, const uint16_t* maxs, unsigned int lanes, uint16_t& minValue, uint16_t& maxValue)
+{
+    for (unsigned int l=0; l<lanes; l++)
+    {
+        minValue = std::min(minValue, mins[l]);
+        maxValue = std::max(maxValue, maxs[l]);
+    }
+}
+
+static void decodeRowSSE2(const uint16_t* src, uint16_t* dst, unsigned int count, uint16_t& minValue, uint16_t& maxValue)
+{
+    const __m128i mask = _mm_set1_epi16(0x3fff);
+    __m128i vmin = _mm_set1_epi16(0x3fff);
+    __m128i vmax = _mm_setzero_si128();
+
+    unsigned int i=0;
+    for (; i+8<=count; i+=8)
+    {
+        const __m128i value = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src+i)), mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i), value);
+        vmin = _mm_min_epi16(vmin, value);
+        vmax = _mm_max_epi16(vmax, value);
+    }
+
+    if (i > 0)
+    {
+        uint16_t mins[8], maxs[8];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), vmin);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), vmax);
+        reduceMinMax(mins, maxs, 8, minValue, maxValue);
+    }
+    decodeRowScalar(src+i, dst+i, count-i, minValue, maxValue);
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TAU_DECODER_AVX2
+__attribute__((target("avx2")))
+static void decodeRowAVX2(const uint16_t* src, uint16_t* dst, unsigned int count, uint16_t& minValue, uint16_t& maxValue)
+{
+    const __m256i mask = _mm256_set1_epi16(0x3fff);
+    __m256i vmin = _mm256_set1_epi16(0x3fff);
+    __m256i vmax = _mm256_setzero_si256();
+
+    unsigned int i=0;
+    for (; i+16<=count; i+=16)
+    {
+        const __m256i value = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src+i)), mask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst+i), value);
+        vmin = _mm256_min_epi16(vmin, value);
+        vmax = _mm256_max_epi16(vmax, value);
+    }
+
+    if (i > 0)
+    {
+        uint16_t mins[16], maxs[16];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(mins), vmin);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(maxs), vmax);
+        reduceMinMax(mins, maxs, 16, minValue, maxValue);
+    }
+    decodeRowSSE2(src+i, dst+i, count-i, minValue, maxValue);
+}
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static void decodeRowNEON(const uint16_t* src, uint16_t* dst, unsigned int count, uint16_t& minValue, uint16_t& maxValue)
+{
+    const uint16x8_t mask = vdupq_n_u16(0x3fff);
+    uint16x8_t vmin = vdupq_n_u16(0x3fff);
+    uint16x8_t vmax = vdupq_n_u16(0);
+
+    unsigned int i=0;
+    for (; i+8<=count; i+=8)
+    {
+        const uint16x8_t value = vandq_u16(vld1q_u16(src+i), mask);
+        vst1q_u16(dst+i, value);
+        vmin = vminq_u16(vmin, value);
+        vmax = vmaxq_u16(vmax, value);
+    }
+
+    if (i > 0)
+    {
+        uint16_t mins[8], maxs[8];
+        vst1q_u16(mins, vmin);
+        vst1q_u16(maxs, vmax);
+        for (unsigned int l=0; l<8; l++)
+        {
+            minValue = std::min(minValue, mins[l]);
+            maxValue = std::max(maxValue, maxs[l]);
+        }
+    }
+    decodeRowScalar(src+i, dst+i, count-i, minValue, maxValue);
+}
+#endif
+
+// Best kernel for the processor, chosen at the first call
+static DecodeRowFunction selectDecodeRow()
+{
+#if defined(TAU_DECODER_AVX2)
+    if (__builtin_cpu_supports("avx2"))
+        return decodeRowAVX2;
+#endif
+#if defined(__SSE2__)
+    return decodeRowSSE2;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    return decodeRowNEON;
+#else
+    return decodeRowScalar;
+#endif
+}
+
+TauImageDecoder::TauImageDecoder() : mTauCoreResWidth(0), mTauCoreResHeight(0), mRoiX(0), mRoiY(0), mRoiWidth(0), mRoiHeight(0)
 {
     mTauRawBitmap = NULL;
 }
 
 TauImageDecoder::~TauImageDecoder()
 {
+    delete mTauRawBitmap;
+}
+
+void TauImageDecoder::setROI(unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+{
+    std::lock_guard<std::mutex> lock(mRoiMutex);
+    mRoiX = x;
+    mRoiY = y;
+    mRoiWidth = width;
+    mRoiHeight = height;
 }
 
-void TauImageDecoder::decodeData(vector<uint16_t> buffer)
+void TauImageDecoder::decodeData(const uint16_t* buffer, unsigned int size)
 {
-    if (buffer.empty())
+    static const DecodeRowFunction decodeRow = selectDecodeRow();
+
+    if (size == 0)
         return;
 
     // Assume the first word to already be data
-    unsigned int size = buffer.size();
-    uint16_t* image_data = buffer.data();
+    const uint16_t* image_data = buffer;
 
     //std::cerr << "size " << size << " w/h " << mTauCoreResWidth << "/" << mTauCoreResHeight << std::endl;
 
-    // Prepare TauRawBitmap
-    mTauRawBitmap = new TauRawBitmap(mTauCoreResWidth, mTauCoreResHeight);
+    // Part of the frame written in the bitmap, limited to the frame (the whole frame if the ROI is empty or outside)
+    unsigned int roiX, roiY, roiWidth, roiHeight;
+    {
+        std::lock_guard<std::mutex> lock(mRoiMutex);
+        roiX = mRoiX;
+        roiY = mRoiY;
+        roiWidth = mRoiWidth;
+        roiHeight = mRoiHeight;
+    }
+    if ((roiWidth == 0) || (roiHeight == 0) || (roiX >= mTauCoreResWidth) || (roiY >= mTauCoreResHeight))
+    {
+        roiX = 0;
+        roiY = 0;
+        roiWidth = mTauCoreResWidth;
+        roiHeight = mTauCoreResHeight;
+    }
+    roiWidth = std::min(roiWidth, mTauCoreResWidth - roiX);
+    roiHeight = std::min(roiHeight, mTauCoreResHeight - roiY);
+
+    // Prepare TauRawBitmap, the same one is used for every frame (it's only lent to frameDecoded)
+    if ((mTauRawBitmap == NULL) || (mTauRawBitmap->width != roiWidth) || (mTauRawBitmap->height != roiHeight))
+    {
+        delete mTauRawBitmap;
+        mTauRawBitmap = new TauRawBitmap(roiWidth, roiHeight);
+    }
+    mTauRawBitmap->pps_timestamp = 0;
 
     // If first value starts with '00' (0b00??|????|????|????),
     // it's a pps value.
-    uint16_t pps = buffer.at(0);
+    uint16_t pps = buffer[0];
     unsigned int beg = 0;
 
     if (!((pps & 0x8000) || (pps & 0x4000)))     // pps found
@@ -90,15 +269,14 @@ void TauImageDecoder::decodeData(vector<uint16_t> buffer)
 
     // If there are any sync words (vsync/hsync begin with '01' or '10')
     // -> skip them
-    while (((buffer.at(beg) & 0x8000) && !(buffer.at(beg) & 0x4000))
-          || (!(buffer.at(beg) & 0x8000) && (buffer.at(beg) & 0x4000)))
+    while ((beg<size) && (((buffer[beg] & 0x8000) && !(buffer[beg] & 0x4000))
+          || (!(buffer[beg] & 0x8000) && (buffer[beg] & 0x4000))))
     {
         beg++;
     }
 
     if (beg>=size)
     {
-        delete mTauRawBitmap;
         return;
     }
 
@@ -106,8 +284,8 @@ void TauImageDecoder::decodeData(vector<uint16_t> buffer)
     size -= beg; // size may be reduced by ccs values and sync words
     image_data += beg; // entry point for image data
 
-    unsigned int maxValue = 0;
-    unsigned int minValue = 65500;
+    uint16_t maxValue = 0;
+    uint16_t minValue = 65500;
 
     unsigned int row = 0;
     unsigned int idx = 0;
@@ -116,39 +294,23 @@ void TauImageDecoder::decodeData(vector<uint16_t> buffer)
 
     if (wordsToRead > size)
     {
-        delete mTauRawBitmap;
         return; //too few data -> can't be a full frame
     }
 
-
-    uint16_t value; // store present value temporary for calculations
     uint16_t* data = mTauRawBitmap->data; // use a pointer for begin of data field in TauRawBitmap
 
     for (row=0; row<mTauCoreResHeight; row++)
     {
-        //if (idx+mTauCoreResWidth-beg > size) // prevent index out of bounce
         if (idx+mTauCoreResWidth > size) // prevent index out of bounce
         {
-            std::cout << "idx+w oob " << idx+mTauCoreResWidth << "/" << size << "/" << buffer.size() << " in row: " << row << std::endl;
-            delete mTauRawBitmap;
+            std::cout << "idx+w oob " << idx+mTauCoreResWidth << "/" << size << "/" << size+beg << " in row: " << row << std::endl;
             return;
         }
 
-        unsigned int baseIdx = row * mTauCoreResWidth;
-
-        for (unsigned int elem=0; elem<mTauCoreResWidth; elem++)
+        // mask, min/max and crop in one pass, straight into the bitmap
+        if ((row >= roiY) && (row < roiY+roiHeight))
         {
-            value = image_data[idx+elem] & 0x3fff; // remove first 2 bits with mask 0b0011 1111 1111 1111
-            data[baseIdx + elem] = value; // store in TauRawBitmap data
-
-            if (value > maxValue)
-                maxValue = value;
-
-            else if(value < minValue)
-                minValue = value;
-
-//            if (value == 0)
-//                std::cout << "zero in row " << row << " idx " << elem << std::endl;
+            decodeRow(image_data+idx+roiX, data+(row-roiY)*roiWidth, roiWidth, minValue, maxValue);
         }
 
         idx += mTauCoreResWidth; // move index to begin of new row
@@ -156,15 +318,14 @@ void TauImageDecoder::decodeData(vector<uint16_t> buffer)
         if (row < mTauCoreResHeight-1) // no searching for new line after last line of image
         {
             // skip invalid data at end of line (if any)
-            while ((image_data[idx] & 0x8000) == 0)
+            while ((idx < size) && ((image_data[idx] & 0x8000) == 0))
             {
                 idx++;
-                if (idx >= size) // prevent index out of bounce
-                {
-                    std::cout << "idx oob 1 " << idx << "/" << size << std::endl;
-                    delete mTauRawBitmap;
-                    return;
-                }
+            }
+            if (idx >= size) // prevent index out of bounce
+            {
+                std::cout << "idx oob 1 " << idx << "/" << size << std::endl;
+                return;
             }
         }
     }
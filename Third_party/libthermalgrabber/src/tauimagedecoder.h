@@ -4,6 +4,7 @@
 #include <thermalgrabber.h>
 
 #include <inttypes.h>
+#include <mutex>
 #include <vector>
 
 using namespace std;
@@ -15,8 +16,12 @@ public:
 
     TauImageDecoder();
     ~TauImageDecoder();
+    //The frame is owned by the decoder and reused for the next frame : it's only valid during the call
     virtual void frameDecoded(TauRawBitmap* frame)=0;
-    void decodeData(vector<uint16_t> buffer);
+    void decodeData(const uint16_t* buffer, unsigned int size);
+    //Part of the frame given in the TauRawBitmap (thread safe, applied from the next frame).
+    //An empty ROI gives the whole frame, a ROI exceeding the frame is cropped.
+    void setROI(unsigned int x, unsigned int y, unsigned int width, unsigned int height);
     void processRawData(TauRawBitmap* tauRawBitmap, TauRGBBitmap* tRGBBitmap);
 
 protected:
@@ -38,6 +43,12 @@ private:
     unsigned int _minRawValue;
     unsigned int _maxRawValue;
 
+    std::mutex mRoiMutex;
+    unsigned int mRoiX;
+    unsigned int mRoiY;
+    unsigned int mRoiWidth;
+    unsigned int mRoiHeight;
+
 };
 
 #endif // TAUIMAGEDECODER_H
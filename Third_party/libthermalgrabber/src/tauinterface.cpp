@@ -3,30 +3,29 @@
 #include <iostream>
 #include <string.h>
 
-bool runWatchDog = false;
-void watchDog(TauInterface* instance)
+void TauInterface::watchDog()
 {
-    TauInterface* ti = instance;
+    std::unique_lock<std::mutex> lock(mWatchDogMutex);
 
-    while (runWatchDog && TauInterface::watchDogCnt)
+    while (mRunWatchDog && mWatchDogCnt)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
-
-        if (TauInterface::watchDogCnt < 9)
-//            std::cerr << "watchdog " << TauInterface::watchDogCnt << std::endl;
+        // woken up by the destructor
+        if (mWatchDogCond.wait_for(lock, std::chrono::milliseconds(500), [this]{ return !mRunWatchDog; }))
+            break;
 
-        TauInterface::watchDogCnt--;
+        mWatchDogCnt--; // reset to 10 by each decoded frame
 
-        if (TauInterface::watchDogCnt == 0)
+        if (mWatchDogCnt == 0)
         {
+            lock.unlock();
 
             std::cerr << "Stopping unresponsive ThermalCapture GrabberUSB" << std::endl;
 
-            ti->stopGrabber();
+            stopGrabber();
 
-            if (ti->threadTauConnection.joinable())
+            if (threadTauConnection.joinable())
             {
-                ti->threadTauConnection.join();
+                threadTauConnection.join();
             }
 
 //            std::cerr << "Resetting usb connection" << std::endl;
@@ -34,24 +33,25 @@ void watchDog(TauInterface* instance)
 
 //            std::cerr << "Connecting ThermalCapture GrabberUSB" << std::endl;
 
-            if (!strcmp(ti->mISerialUSB, ""))
+            if (!strcmp(mISerialUSB, ""))
             {
                 std::cerr << "Trying to connect first available ThermalCapture GrabberUSB" << std::endl;
-                ti->reenableFTDIConnection();
-                ti->connect();
-                TauInterface::watchDogCnt = 10; // reset watchdog
+                reenableFTDIConnection();
+                connect();
+                mWatchDogCnt = 10; // reset watchdog
             }
             else
             {
-                std::cerr << "Trying to connect ThermalCapture GrabberUSB " << ti->mISerialUSB << std::endl;
-                ti->reenableFTDIConnection();
-                ti->connect(ti->mISerialUSB);
-                TauInterface::watchDogCnt = 10; // reset watchdog
+                std::cerr << "Trying to connect ThermalCapture GrabberUSB " << mISerialUSB << std::endl;
+                reenableFTDIConnection();
+                connect(mISerialUSB);
+                mWatchDogCnt = 10; // reset watchdog
             }
+
+            lock.lock();
         }
     }
 }
-unsigned int TauInterface::watchDogCnt = 10;
 
 //
 //--- SET function codes without command/data bytes ----
@@ -150,31 +150,30 @@ static constexpr char GET_DIGITAL_OUTPUT_MODE_CMOS_MODE[3] = {0x12, 0x08, 0x00};
 static constexpr char GET_TLIN_ENABLED[3] = {(char)0x8E, 0x00, 0x40};
 
 
-bool flirComOk = false;
-bool tcConnected = false;
-unsigned long frameCnt = 0;
-
 void TauInterface::reenableFTDIConnection()
 {
-    flirComOk = false;
-    tcConnected = false;
+    mFlirComOk = false;
+    mTcConnected = false;
     reenableFTDI();
 }
 
-TauInterface::TauInterface(callbackTauRawBitmapUpdate cb, void* caller) : mVideoProcessingEnabled(false)
+TauInterface::TauInterface(callbackTauRawBitmapUpdate cb, void* caller) : mVideoProcessingEnabled(false),
+    mFlirComOk(false), mTcConnected(false), mWatchDogCnt(10), mRunWatchDog(true)
 {
-    mTauRawBitmap = NULL;
     mCallback = (callbackTauRawBitmapUpdate)cb;
     mCallbackInstance = caller;
 
-    runWatchDog = true;
-    std::thread threadWD(watchDog, this);
+    std::thread threadWD(&TauInterface::watchDog, this);
     threadWatchdog = std::move(threadWD);
 }
 
 TauInterface::~TauInterface()
 {
-    runWatchDog = false;
+    {
+        std::lock_guard<std::mutex> lock(mWatchDogMutex);
+        mRunWatchDog = false;
+    }
+    mWatchDogCond.notify_all();
     if (threadWatchdog.joinable())
     {
         threadWatchdog.join();
@@ -182,23 +181,24 @@ TauInterface::~TauInterface()
 
 
     stopGrabber();
-    tcConnected = false;
+    mTcConnected = false;
     if (threadTauConnection.joinable())
     {
         threadTauConnection.join();
     }
+    stopDecoder(); // processVideoData must not be called on a destroyed object
 }
 
-static void threadWrapper(TauInterface* ti, const char* iSerialUSB)
+void TauInterface::runConnection(const char* iSerialUSB)
 {
 //    std::cout << "thread wrapper" << std::endl;
-    ti->runGrabber(iSerialUSB);
-    tcConnected = false;
+    runGrabber(iSerialUSB);
+    mTcConnected = false;
 }
 
 bool TauInterface::isConnected()
 {
-    return tcConnected;
+    return mTcConnected;
 }
 
 bool TauInterface::isConfigUpdated()
@@ -210,14 +210,11 @@ bool TauInterface::isConfigUpdated()
 
 bool TauInterface::connect()
 {
-    // Startup time
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
     //-------------------------------------------------------------------------
     // Connect to first found ThermalCapture GrabberUSB
-    std::thread thread(threadWrapper, this, (char*)"\0");//(char*)0);
+    mTcConnected = true; // before the thread starts, runConnection resets it if runGrabber returns
+    std::thread thread(&TauInterface::runConnection, this, (char*)"\0");//(char*)0);
     threadTauConnection = std::move(thread);
-    tcConnected = true;
 
     return checkSettings();
 }
@@ -227,14 +224,11 @@ bool TauInterface::connect(const char* iSerialUSB)
     // safe the iSerialUSB for possible reconnects
     strncpy(&mISerialUSB[0], iSerialUSB, sizeof(mISerialUSB));
 
-    // Startup time
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
     //-------------------------------------------------------------------------
     // Connect ThermalCapture GrabberUSB with defined USB serial (iSerial)
-    std::thread thread(threadWrapper, this, iSerialUSB);
+    mTcConnected = true; // before the thread starts, runConnection resets it if runGrabber returns
+    std::thread thread(&TauInterface::runConnection, this, iSerialUSB);
     threadTauConnection = std::move(thread);
-    tcConnected = true;
 
     return checkSettings();
 }
@@ -242,24 +236,27 @@ bool TauInterface::connect(const char* iSerialUSB)
 bool TauInterface::checkSettings()
 {
     //-------------------------------------------------------------------------
-    // Reset the flirComOk to false.
+    // Be sure that the usb part is ready (startup time of the grabber)
+    if (!waitGrabberRuns(1000))
+    {
+        std::cerr << "Timeout: Communication problem with ThermalCapture GrabberUSB" << std::endl;
+        return false;
+    }
+
+    //-------------------------------------------------------------------------
+    // Reset the mFlirComOk to false.
     // Check if the flir device responds within time out
-    flirComOk = false; // reset
+    mFlirComOk = false; // reset
 
     for (int i=0; i<10; i++)
     {
-        if (!flirComOk)   // tcComOk becomes true if no_op response from flir device is received
-        {
-            if (grabberRuns)    // be sure that the usb part is ready
-                sendCommand(NO_OP[0], 0, 0);
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
+        if (!mFlirComOk)   // tcComOk becomes true if no_op response from flir device is received
+            sendCommand(NO_OP[0], 0, 0, 100);
         else    // communication with flir device seems to be working... ...go on
             break;
     }
 
-    if (!flirComOk)
+    if (!mFlirComOk)
     {
         std::cerr << "Timeout: Communication problem with ThermalCapture GrabberUSB" << std::endl;
         return false;
@@ -268,12 +265,9 @@ bool TauInterface::checkSettings()
     //-------------------------------------------------------------------------
     // Infos about resolution are needed for processing incoming data.
     // Try to identify the flir device until timeout occurs.
-
-    // wait additional 500ms before giving up getting config of camera
     for (int i=0; i<5; i++)
     {
         identifyTauCore();
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
         if (isConfigUpdated()) // config done? -> return
             break;
@@ -287,6 +281,7 @@ bool TauInterface::checkSettings()
 
     //-------------------------------------------------------------------------
     // Check settings of Flir device
+    // The replies are interpreted with mPresentRequestDigitalOutput, so these requests are sent one after the other.
     bool safeSettings = false;
     bool configIsRead = false;
 
@@ -296,50 +291,45 @@ bool TauInterface::checkSettings()
         {
             mPresentRequestDigitalOutput = REQ_DIGITAL_OUTPUT_ENABLED;
 
-            if (grabberRuns)
-                sendCommand(GET_DIGITAL_OUTPUT_MODE[0],
-                        const_cast<char*>(&GET_DIGITAL_OUTPUT_MODE[1]),
-                        sizeof(GET_DIGITAL_OUTPUT_MODE)-1);
+            sendCommand(GET_DIGITAL_OUTPUT_MODE[0],
+                    const_cast<char*>(&GET_DIGITAL_OUTPUT_MODE[1]),
+                    sizeof(GET_DIGITAL_OUTPUT_MODE)-1);
         }
         else if (!mDigitalOutputXPMode14bitChecked)
         {
             mPresentRequestDigitalOutput = REQ_DIGITAL_OUTPUT_XP_MODE;
 
-            if (grabberRuns)
-                sendCommand(GET_DIGITAL_OUTPUT_MODE_XP_MODE[0],
-                        const_cast<char*>(&GET_DIGITAL_OUTPUT_MODE_XP_MODE[1]),
-                        sizeof(GET_DIGITAL_OUTPUT_MODE_XP_MODE)-1);
+            sendCommand(GET_DIGITAL_OUTPUT_MODE_XP_MODE[0],
+                    const_cast<char*>(&GET_DIGITAL_OUTPUT_MODE_XP_MODE[1]),
+                    sizeof(GET_DIGITAL_OUTPUT_MODE_XP_MODE)-1);
         }
         else if (!mDigitalOutputCMOSBitDepth14bitChecked)
         {
             mPresentRequestDigitalOutput = REQ_DIGITAL_OUTPUT_CMOS_MODE;
 
-            if (grabberRuns)
-                sendCommand(GET_DIGITAL_OUTPUT_MODE_CMOS_MODE[0],
-                        const_cast<char*>(&GET_DIGITAL_OUTPUT_MODE_CMOS_MODE[1]),
-                        sizeof(GET_DIGITAL_OUTPUT_MODE_CMOS_MODE)-1);
+            sendCommand(GET_DIGITAL_OUTPUT_MODE_CMOS_MODE[0],
+                    const_cast<char*>(&GET_DIGITAL_OUTPUT_MODE_CMOS_MODE[1]),
+                    sizeof(GET_DIGITAL_OUTPUT_MODE_CMOS_MODE)-1);
         }
         /*else if (!mTLinearEnabledChecked)
         {
             mPresentRequestTLin = REQ_GET_TLIN_ENABLED;
 
-            if (grabberRuns)
-                sendCommand(GET_TLIN_ENABLED[0],
-                        const_cast<char*>(&GET_TLIN_ENABLED[1]),
-                        sizeof(GET_TLIN_ENABLED)-1);
+            sendCommand(GET_TLIN_ENABLED[0],
+                    const_cast<char*>(&GET_TLIN_ENABLED[1]),
+                    sizeof(GET_TLIN_ENABLED)-1);
         }*/
         else
         {
             configIsRead = true;
             break;
         }
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(250));
     }
 
     if (!configIsRead)
         return false;
 
+
 //    std::cout << "Results of config check:" << std::endl;
 //
 //    if (mDigitalOutputEnabledStatus)
@@ -373,12 +363,9 @@ bool TauInterface::checkSettings()
         std::cout << "Enabling CMOS 14 bit" << std::endl;
 
         // enable digital output cmos 14 bit
-        if (grabberRuns)
-            sendCommand(DIGITAL_OUTPUT_MODE_CMOS_BIT_DEPTH_14[0],
-                    const_cast<char*>(&DIGITAL_OUTPUT_MODE_CMOS_BIT_DEPTH_14[1]),
-                    sizeof(DIGITAL_OUTPUT_MODE_CMOS_BIT_DEPTH_14)-1);
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        sendCommand(DIGITAL_OUTPUT_MODE_CMOS_BIT_DEPTH_14[0],
+                const_cast<char*>(&DIGITAL_OUTPUT_MODE_CMOS_BIT_DEPTH_14[1]),
+                sizeof(DIGITAL_OUTPUT_MODE_CMOS_BIT_DEPTH_14)-1);
     }
 
     if (!mDigitalOutputXPMode14bitStatus)
@@ -387,12 +374,9 @@ bool TauInterface::checkSettings()
         std::cout << "Enabling XP Mode 14 bit" << std::endl;
 
         // enable digital output xp mode 14 bit
-        if (grabberRuns)
-            sendCommand(DIGITAL_OUTPUT_MODE_XP_MODE_CMOS_14_BIT[0],
-                    const_cast<char*>(&DIGITAL_OUTPUT_MODE_XP_MODE_CMOS_14_BIT[1]),
-                    sizeof(DIGITAL_OUTPUT_MODE_XP_MODE_CMOS_14_BIT)-1);
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        sendCommand(DIGITAL_OUTPUT_MODE_XP_MODE_CMOS_14_BIT[0],
+                const_cast<char*>(&DIGITAL_OUTPUT_MODE_XP_MODE_CMOS_14_BIT[1]),
+                sizeof(DIGITAL_OUTPUT_MODE_XP_MODE_CMOS_14_BIT)-1);
     }
 
     if (!mDigitalOutputEnabledStatus)
@@ -401,12 +385,9 @@ bool TauInterface::checkSettings()
         std::cout << "Enabling Digital Output" << std::endl;
 
         // enable digital output
-        if (grabberRuns)
-            sendCommand(DIGITAL_OUTPUT_MODE_ENABLE[0],
-                    const_cast<char*>(&DIGITAL_OUTPUT_MODE_ENABLE[1]),
-                    sizeof(DIGITAL_OUTPUT_MODE_ENABLE)-1);
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        sendCommand(DIGITAL_OUTPUT_MODE_ENABLE[0],
+                const_cast<char*>(&DIGITAL_OUTPUT_MODE_ENABLE[1]),
+                sizeof(DIGITAL_OUTPUT_MODE_ENABLE)-1);
     }
 
 //    if (!mTLinearEnabledStatus)
@@ -428,13 +409,9 @@ bool TauInterface::checkSettings()
     // safe settings should only be done if neccessary (write cycles)
     if (safeSettings)
     {
+        // the settings have been acknowledged by the core, the reply comes once they are written
         std::cout << "Save settings" << std::endl;
-        if (grabberRuns)
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(2000));
-            sendCommand(0x01, 0, 0);
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
-        }
+        sendCommand(SET_DEFAULTS[0], 0, 0, 3000);
     }
 
     return true;
@@ -442,29 +419,91 @@ bool TauInterface::checkSettings()
 
 void TauInterface::frameDecoded(TauRawBitmap* tauRawBitmap)
 {
-    if (mTauRawBitmap != NULL)
-        delete mTauRawBitmap;
-    mTauRawBitmap = tauRawBitmap;
+    tauRawBitmap->usbTime = getFrameUsbTime();
+    tauRawBitmap->decodedTime = std::chrono::steady_clock::now();
+    mCallback(*tauRawBitmap,  mCallbackInstance);
+}
 
-    mCallback(*mTauRawBitmap,  mCallbackInstance);
+bool TauInterface::sendCommand(char cmd, char *data, unsigned int data_len, unsigned int timeoutMs)
+{
+    // The reply is enough to be sure tau core / vue has processed the command
+    std::future<bool> reply = sendCommandAsync(cmd, data, data_len, timeoutMs);
+    return waitReply(reply, timeoutMs);
 }
 
-void TauInterface::sendCommand(char cmd, char *data, unsigned int data_len)
+std::future<bool> TauInterface::sendCommandAsync(char cmd, char *data, unsigned int data_len, unsigned int timeoutMs)
 {
-    if (isConnected())
+    PendingCommand command;
+    std::future<bool> reply = command.reply.get_future();
+
+    if (!isConnected())
     {
-        //uint8_t buffer[32];
-        uint8_t buffer[64];
-        // char cmd, len of data, pointer to data, transfer buffer
-        int size=genTauFrame(cmd, data_len, (uint8_t*)data, buffer);
-        sendUartData(buffer, size);
-
-        // Small pause to be sure tau core / vue has processed the command
-        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        std::cerr << "TauInterface: Send command failed - not connected" << std::endl;
+        command.reply.set_value(false);
+        return reply;
     }
-    else
+
+    expirePendingCommands();
+
+    // registered before sending, so that the reply can't be missed
+    command.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
     {
-        std::cerr << "TauInterface: Send command failed - not connected" << std::endl;
+        std::lock_guard<std::mutex> lock(mPendingMutex);
+        mPendingCommands[(uint8_t)cmd].push_back(std::move(command));
+    }
+
+    //uint8_t buffer[32];
+    uint8_t buffer[64];
+    // char cmd, len of data, pointer to data, transfer buffer
+    int size=genTauFrame(cmd, data_len, (uint8_t*)data, buffer);
+    sendUartData(buffer, size);
+
+    return reply;
+}
+
+bool TauInterface::waitReply(std::future<bool>& reply, unsigned int timeoutMs)
+{
+    if (reply.wait_for(std::chrono::milliseconds(timeoutMs)) != std::future_status::ready)
+        expirePendingCommands(); // the deadline of the command has passed, its future becomes false
+
+    return reply.get();
+}
+
+void TauInterface::completePendingCommand(uint8_t function)
+{
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    std::map<uint8_t, std::deque<PendingCommand> >::iterator it = mPendingCommands.find(function);
+    if (it == mPendingCommands.end())
+        return;
+
+    // A late reply of an expired command would be taken for the reply of the next one : they are given up first
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::deque<PendingCommand>& commands = it->second;
+    while (!commands.empty() && commands.front().deadline < now)
+    {
+        commands.front().reply.set_value(false);
+        commands.pop_front();
+    }
+
+    if (!commands.empty())
+    {
+        commands.front().reply.set_value(true);
+        commands.pop_front();
+    }
+}
+
+void TauInterface::expirePendingCommands()
+{
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (std::map<uint8_t, std::deque<PendingCommand> >::iterator it = mPendingCommands.begin(); it != mPendingCommands.end(); ++it)
+    {
+        std::deque<PendingCommand>& commands = it->second;
+        while (!commands.empty() && commands.front().deadline <= now)
+        {
+            commands.front().reply.set_value(false);
+            commands.pop_front();
+        }
     }
 }
 
@@ -506,8 +545,8 @@ void TauInterface::processSerialPacket(uint8_t* buffer, uint32_t size)
 
     case 0x00:
         //std::cout << "No op" << std::endl;
-        if (!flirComOk)
-            flirComOk = true;
+        if (!mFlirComOk)
+            mFlirComOk = true;
         break;
 
     case 0x01:
@@ -795,15 +834,14 @@ void TauInterface::processSerialPacket(uint8_t* buffer, uint32_t size)
 
     }
     //std::cout << std::endl;
+
+    // the reply has been processed, the command waiting for it is completed
+    completePendingCommand(buffer[3]);
 }
 
 
 void TauInterface::processVideoData(uint16_t* buffer, uint32_t size)
 {
-    vector<uint16_t> v;
-    v.resize(size);
-    memcpy(v.data(), buffer, size*2);
-
 //    std::cout << "processing video data" << std::endl;
 
     // Video processing uses the tau core properties for performance reasons.
@@ -811,9 +849,9 @@ void TauInterface::processVideoData(uint16_t* buffer, uint32_t size)
     if (mVideoProcessingEnabled)
     {
         // Infos about tau core especially resolution are present -> process data
-        decodeData(v);
+        decodeData(buffer, size); // decoded from the frame buffer of ThermoGrabber, no copy
 
-        watchDogCnt = 10;
+        mWatchDogCnt = 10;
     }
 }
 
@@ -821,17 +859,23 @@ void TauInterface::processVideoData(uint16_t* buffer, uint32_t size)
 
 void TauInterface::identifyTauCore()
 {
+    // The requests are independent : they are sent together, then their replies are waited for
+    std::vector<std::future<bool> > replies;
+
     // get the camera part number with informations about tau core (resolution etc.)
     if (mTauCoreResHeight==0 || mTauCoreResWidth==0)
-        sendCommand(CAMERA_PART[0], 0, 0);
+        replies.push_back(sendCommandAsync(CAMERA_PART[0], 0, 0));
 
     // get serial numbers of tau core and sensor
     if (mCameraSerial==0 || mSensorSerial==0)
-        sendCommand(SERIAL_NUMBER[0], 0, 0);
+        replies.push_back(sendCommandAsync(SERIAL_NUMBER[0], 0, 0));
 
     // get revision
     if ((mSWMajorVersion==0 && mSWMinorVersion==0) || (mFWMajorVersion==0 && mFWMinorVersion==0))
-        sendCommand(GET_REVISION[0], 0, 0);
+        replies.push_back(sendCommandAsync(GET_REVISION[0], 0, 0));
+
+    for (size_t i=0; i<replies.size(); i++)
+        waitReply(replies[i]);
 }
 
 //
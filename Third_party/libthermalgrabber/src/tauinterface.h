@@ -4,9 +4,19 @@
 #include <thermograbber.h>
 #include <taucom.h>
 #include <tauimagedecoder.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
 #include <vector>
 #include <thread>
 
+// Default time to wait for the reply of the tau core to a command
+#define TAU_COMMAND_TIMEOUT_MS 500
+
 class TauInterface : public ThermoGrabber, private TauCom, private TauImageDecoder
 {
 
@@ -37,9 +47,20 @@ public:
       * Please see "FLIR TAU2/QUARK2 SOFTWARE IDD" for options.
       * First byte is the function byte.
       * Optional following bytes are commands and command parameter.
+      * Waits until the tau core has replied (returns true) or the timeout has expired (returns false).
+     */
+    bool sendCommand(char cmd, char* data, unsigned int data_len, unsigned int timeoutMs = TAU_COMMAND_TIMEOUT_MS);
+
+    /**
+      * Same as sendCommand, without waiting. The future becomes true when the reply is received
+      * (after it has been processed), false if there is no reply within the timeout.
+      * The replies are matched with the commands by function code, in the order of the commands,
+      * so several commands can be pipelined. Use waitReply to wait for the result.
      */
-    void sendCommand(char cmd, char* data, unsigned int data_len);
+    std::future<bool> sendCommandAsync(char cmd, char* data, unsigned int data_len, unsigned int timeoutMs = TAU_COMMAND_TIMEOUT_MS);
+    bool waitReply(std::future<bool>& reply, unsigned int timeoutMs = TAU_COMMAND_TIMEOUT_MS);
     void frameDecoded(TauRawBitmap *frame);
+    using TauImageDecoder::setROI;
 
     //Called by ThermoGrabber
     void processUartData(uint8_t* buffer,uint32_t size);
@@ -85,8 +106,6 @@ public:
     void disableDigitalOutputMode_XPMode();
     void setDigitalOutputMode_XPModeCMOSBitDepth14();
 
-    // If watchDogCnt becomes zero, connection gets resetted
-    static unsigned int watchDogCnt;
     void reenableFTDIConnection();
 
     std::thread threadTauConnection; // reference to the tau connection thread
@@ -94,7 +113,6 @@ public:
 
 private:
 
-    TauRawBitmap* mTauRawBitmap;
     callbackTauRawBitmapUpdate mCallback;// callback for received images
     void* mCallbackInstance;
     bool isConnected();
@@ -142,6 +160,30 @@ private:
         REQ_GET_TLIN_MODE
     } mPresentRequestTLin;
 
+    // The state of the connection is kept per instance, so that several grabbers can be used in the same process.
+    // mWatchDogCnt is decremented every 500ms by the watchdog thread of the instance and reset to 10 by each decoded frame.
+    // If it becomes zero (no frame decoded for 5s, also before the first frame), the connection of this instance gets resetted.
+    std::atomic<bool> mFlirComOk;   // becomes true when the no_op response of the tau core is received
+    std::atomic<bool> mTcConnected; // true while the connection thread runs
+    std::atomic<unsigned int> mWatchDogCnt;
+
+    void watchDog();
+    void runConnection(const char* iSerialUSB);
+
+    // Commands waiting for their reply, by function code (oldest first)
+    struct PendingCommand
+    {
+        std::promise<bool> reply;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    std::map<uint8_t, std::deque<PendingCommand>> mPendingCommands;
+    std::mutex mPendingMutex;
+    void completePendingCommand(uint8_t function);
+    void expirePendingCommands();
+
+    bool mRunWatchDog;
+    std::mutex mWatchDogMutex;
+    std::condition_variable mWatchDogCond;
     std::thread threadWatchdog;
 
 };
@@ -9,26 +9,35 @@
 #include <iostream>
 #include <sstream>
 
-TauInterface* mTauInterface;
-
-ThermalGrabber::ThermalGrabber(callbackThermalGrabber ptr, void* caller): opened(false)
+ThermalGrabber::ThermalGrabber(callbackThermalGrabber ptr, void* caller): mTauInterface(NULL), opened(false)
 {
-    mTauInterface = NULL;
     mCallbackThermalGrabber = ptr;
     mCallingInstance = caller;
     mTauInterface = new TauInterface(static_callbackTauData, this);
     opened = mTauInterface->connect();
 }
 
-ThermalGrabber::ThermalGrabber(callbackThermalGrabber ptr, void* caller, const char* iSerialUSB): opened(false)
+ThermalGrabber::ThermalGrabber(callbackThermalGrabber ptr, void* caller, const char* iSerialUSB): mTauInterface(NULL), opened(false)
 {
-    mTauInterface = NULL;
     mCallbackThermalGrabber = ptr;
     mCallingInstance = caller;
     mTauInterface = new TauInterface(static_callbackTauData, this);
     opened = mTauInterface->connect(iSerialUSB);
 }
 
+ThermalGrabber::ThermalGrabber(callbackThermalGrabber ptr, void* caller, const char* iSerialUSB,
+                               const thermal_grabber::StreamOptions& streamOptions): mTauInterface(NULL), opened(false)
+{
+    mCallbackThermalGrabber = ptr;
+    mCallingInstance = caller;
+    mTauInterface = new TauInterface(static_callbackTauData, this);
+    mTauInterface->setStreamOptions(streamOptions);
+    if (iSerialUSB == NULL || iSerialUSB[0] == '\0')
+        opened = mTauInterface->connect();
+    else
+        opened = mTauInterface->connect(iSerialUSB);
+}
+
 ThermalGrabber::~ThermalGrabber()
 {
     if (mTauInterface != NULL)
@@ -52,6 +61,14 @@ void ThermalGrabber::sendCommand(char cmd, char* data, unsigned int data_len)
         mTauInterface->sendCommand(cmd, data, data_len);
 }
 
+bool ThermalGrabber::setThreadConfig(const thermal_grabber::ThreadConfig& usbEvents, const thermal_grabber::ThreadConfig& decoder)
+{
+    if (mTauInterface == NULL)
+        return false;
+
+    return mTauInterface->setThreadConfig(usbEvents, decoder);
+}
+
 unsigned int ThermalGrabber::scale(unsigned int value, unsigned int lowBound, unsigned int upBound , unsigned int minOutput, unsigned int maxOutput)
 {
     if( upBound == lowBound )
@@ -94,10 +111,36 @@ void ThermalGrabber::convertTauRawBitmapToTauRGBBitmap(TauRawBitmap &tauRawBitma
             &&
             (tauRawBitmap.width == tauRGBBitmap.width && tauRawBitmap.height == tauRGBBitmap.height))
     {
-        for (int i=0; i<tauRawBitmap.height*tauRawBitmap.width; i++)
+        const unsigned int size = tauRawBitmap.height*tauRawBitmap.width;
+        const unsigned int lowBound = tauRawBitmap.min;
+        const unsigned int upBound = tauRawBitmap.max;
+        if (upBound == lowBound)
         {
-            unsigned int val = tauRawBitmap.data[i];
-            unsigned int s = scale(val, tauRawBitmap.min, tauRawBitmap.max, 0, 255);
+            // same result as scale() for every pixel, but the error is only printed once
+            std::cerr << "Error: Boundaries equal: " << lowBound << ", " << upBound << std::endl;
+            memset(tauRGBBitmap.data, 0, size*3);
+            return;
+        }
+
+        // The scaled values are computed once for the range of the bitmap, then looked up for each pixel.
+        // Values outside of the range are clamped as scale() does.
+        if (upBound > lowBound)
+        {
+            mRgbLut.resize(upBound-lowBound+1);
+            for (unsigned int v=lowBound; v<=upBound; v++)
+                mRgbLut[v-lowBound] = scale(v, lowBound, upBound, 0, 255);
+        }
+
+        for (unsigned int i=0; i<size; i++)
+        {
+            const unsigned int val = tauRawBitmap.data[i];
+            unsigned char s;
+            if (val <= lowBound)
+                s = 0;
+            else if (val >= upBound)
+                s = 255;
+            else
+                s = mRgbLut[val-lowBound];
             tauRGBBitmap.data[i*3] = s;
             tauRGBBitmap.data[i*3+1] = s;
             tauRGBBitmap.data[i*3+2] = s;
@@ -197,6 +240,14 @@ void ThermalGrabber::doFFC()
         std::cerr << "doFFC failed: No connection to tau core" << std::endl;
 }
 
+void ThermalGrabber::setROI(unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+{
+    if (mTauInterface != NULL)
+        mTauInterface->setROI(x, y, width, height);
+    else
+        std::cerr << "setROI failed: No connection to tau core" << std::endl;
+}
+
 void ThermalGrabber::setGainMode(thermal_grabber::GainMode gm)
 {
     if (mTauInterface != NULL)
@@ -11,6 +11,19 @@
 #include <thermograbber.h>
 #include <unistd.h>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 #ifdef __MACH__
 #include <mach/clock.h>
@@ -19,12 +32,68 @@
 
 #define MAX_FRAME_BUFFER_SIZE 384000 // 640x600 max
 #define MIN_FRAME_BUFFER_SIZE 20480 // 160x128
+#define FRAME_BUFFER_COUNT 4 // 1 filled by the parser, 1 being decoded, up to 2 waiting
 
 using namespace std;
 
+static const char teaxHeader[]="TEAX";
+static const char uartHeader[]="UART";
+
+// Returns the position of the first byte that can start a header ('T' or 'U'), or length if there is none
+static int findHeaderStart(const uint8_t* data, int length)
+{
+    int i=0;
+
+#if defined(__SSE2__) && defined(__GNUC__)
+    const __m128i t=_mm_set1_epi8('T');
+    const __m128i u=_mm_set1_epi8('U');
+    for(;i+16<=length;i+=16)
+    {
+        const __m128i block=_mm_loadu_si128(reinterpret_cast<const __m128i*>(data+i));
+        const int mask=_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block,t),_mm_cmpeq_epi8(block,u)));
+        if(mask!=0)
+            return i+__builtin_ctz(mask);
+    }
+#else
+    // memchr is vectorized by the C library, the second search stops at the first 'T'
+    const void* t=memchr(data,'T',length);
+    const int end=(t!=NULL) ? static_cast<int>(static_cast<const uint8_t*>(t)-data) : length;
+    const void* u=memchr(data,'U',end);
+    return (u!=NULL) ? static_cast<int>(static_cast<const uint8_t*>(u)-data) : end;
+#endif
+
+    for(;i<length;i++)
+    {
+        if((data[i]=='T')||(data[i]=='U'))
+            return i;
+    }
+    return length;
+}
+
+// Copies count bytes of payload at the byte position offset of the frame buffer (16 bit words sent little endian)
+static void copyPayload(uint16_t* framebuffer, int offset, const uint8_t* data, int count)
+{
+#if (defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)) || defined(_WIN32)
+    memcpy(reinterpret_cast<uint8_t*>(framebuffer)+offset,data,count);
+#else
+    for(int i=0;i<count;i++,offset++)
+    {
+        if((offset%2)==0)
+            framebuffer[offset/2]=data[i];
+        else
+            framebuffer[offset/2]|=data[i]<<8;
+    }
+#endif
+}
+
 struct ThermoGrabberPrivate
 {
     FTDIDevice dev;
+    bool devOpened; // dev is only closed if it has been opened (an instance can be destroyed without being connected)
+    bool grabberFailed; // runGrabber could not set up the connection
+    FTDIStreamOptions streamOptions; // options given to FTDIDevice_ReadStreamOptions
+    std::mutex runMutex; // protects grabberRuns and grabberFailed for waitGrabberRuns
+    std::condition_variable runCond;
     int stop;
     int byte_count;
     int parser_state;
@@ -36,12 +105,105 @@ struct ThermoGrabberPrivate
     int uart_in_counter;
     unsigned char uart_in_buffer[256];
     struct timespec starttime;
-    uint16_t framebuffer[MAX_FRAME_BUFFER_SIZE];
+    uint16_t* framebuffer; // buffer filled by the parser
+    std::chrono::steady_clock::time_point frameUsbTime; // arrival of the first payload of the frame being parsed
+
+    // Hand-off of the complete frames to the decoder thread, so that the USB thread is never blocked by the decoding.
+    // The queue is bounded by the number of buffers : if the decoder is too slow, the oldest waiting frame is dropped.
+    uint16_t framebuffers[FRAME_BUFFER_COUNT][MAX_FRAME_BUFFER_SIZE];
+    uint16_t* freeBuffers[FRAME_BUFFER_COUNT];
+    int freeCount;
+    uint16_t* readyBuffers[FRAME_BUFFER_COUNT]; // circular queue of the frames waiting for the decoder
+    uint32_t readySizes[FRAME_BUFFER_COUNT];
+    std::chrono::steady_clock::time_point readyUsbTimes[FRAME_BUFFER_COUNT];
+    std::chrono::steady_clock::time_point decodedUsbTime; // arrival of the frame being given to processVideoData (decoder thread)
+    int readyFirst;
+    int readyCount;
+    unsigned int droppedFrames;
+    bool decoderRuns;
+    std::mutex decoderMutex;
+    std::condition_variable decoderCond;
+    std::thread decoderThread;
+
+    // Scheduling of the USB and decoder threads (see setThreadConfig).
+    // Each thread applies its configuration when it starts, setThreadConfig applies it to the running threads.
+    std::mutex threadMutex;
+    thermal_grabber::ThreadConfig usbThreadConfig;
+    thermal_grabber::ThreadConfig decoderThreadConfig;
+#ifdef __linux__
+    pthread_t usbThreadId;
+    pthread_t decoderThreadId;
+#endif
+    bool usbThreadRuns; // the USB thread streams the data
+    bool decoderThreadRuns;
 };
 
+static bool isDefaultConfig(const thermal_grabber::ThreadConfig& config)
+{
+    return config.cpu < 0 && config.rtPriority <= 0;
+}
+
+#ifdef __linux__
+// Pins the thread and sets its scheduling, returns false if a setting could not be applied
+static bool applyThreadConfig(pthread_t thread, const thermal_grabber::ThreadConfig& config)
+{
+    bool ok = true;
+
+    if (config.cpu >= 0)
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(config.cpu, &cpuSet); // ignored if cpu >= CPU_SETSIZE, the empty set is then rejected
+        const int err = pthread_setaffinity_np(thread, sizeof(cpuSet), &cpuSet);
+        if (err != 0)
+        {
+            std::cerr << "Thread: could not pin the thread on core " << config.cpu << " (" << strerror(err) << ")" << std::endl;
+            ok = false;
+        }
+    }
+
+    if (config.rtPriority > 0)
+    {
+        sched_param param;
+        param.sched_priority = config.rtPriority;
+        const int err = pthread_setschedparam(thread, SCHED_FIFO, &param);
+        if (err != 0)
+        {
+            std::cerr << "Thread: could not set the real-time scheduling (" << strerror(err) << ")" << std::endl;
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+#endif
+
+// Called by the USB or decoder thread when it starts (runs=true) or stops (runs=false)
+static void registerThread(ThermoGrabberPrivate* tgP, bool decoder, bool runs)
+{
+    std::lock_guard<std::mutex> lock(tgP->threadMutex);
+    bool& threadRuns = decoder ? tgP->decoderThreadRuns : tgP->usbThreadRuns;
+    threadRuns = runs;
+
+#ifdef __linux__
+    if (runs)
+    {
+        pthread_t& threadId = decoder ? tgP->decoderThreadId : tgP->usbThreadId;
+        threadId = pthread_self();
+
+        const thermal_grabber::ThreadConfig& config = decoder ? tgP->decoderThreadConfig : tgP->usbThreadConfig;
+        if (!isDefaultConfig(config))
+            applyThreadConfig(threadId, config);
+    }
+#endif
+}
+
 ThermoGrabber::ThermoGrabber() : grabberRuns(false), mPPSTimestamp(0)
 {
     tgP= new ThermoGrabberPrivate;
+    tgP->devOpened=false;
+    tgP->grabberFailed=false;
+    FTDIStreamOptions_Default(&tgP->streamOptions);
     tgP->stop=0;
     tgP->byte_count=0;
     tgP->parser_state=0;
@@ -51,16 +213,173 @@ ThermoGrabber::ThermoGrabber() : grabberRuns(false), mPPSTimestamp(0)
     tgP->frames=0;
     tgP->uart_in_size=0;
     tgP->uart_in_counter=0;
+    tgP->framebuffer=tgP->framebuffers[0];
+    for(int b=1;b<FRAME_BUFFER_COUNT;b++)
+        tgP->freeBuffers[b-1]=tgP->framebuffers[b];
+    tgP->freeCount=FRAME_BUFFER_COUNT-1;
+    tgP->readyFirst=0;
+    tgP->readyCount=0;
+    tgP->droppedFrames=0;
+    tgP->decoderRuns=false;
+    tgP->usbThreadRuns=false;
+    tgP->decoderThreadRuns=false;
 }
 
 ThermoGrabber::~ThermoGrabber()
 {
+    stopDecoder(); // the derived class should have stopped it already, processVideoData can't be called anymore
     delete tgP;
 }
 
+void ThermoGrabber::startDecoder()
+{
+    if(tgP->decoderThread.joinable())
+        return;
+
+    tgP->decoderRuns=true;
+    tgP->decoderThread=std::thread(&ThermoGrabber::decoderLoop,this);
+}
+
+void ThermoGrabber::stopDecoder()
+{
+    if(!tgP->decoderThread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(tgP->decoderMutex);
+        tgP->decoderRuns=false;
+    }
+    tgP->decoderCond.notify_one();
+    tgP->decoderThread.join();
+}
+
+std::chrono::steady_clock::time_point ThermoGrabber::getFrameUsbTime()
+{
+    return tgP->decodedUsbTime;
+}
+
+unsigned int ThermoGrabber::getDroppedFrames()
+{
+    std::lock_guard<std::mutex> lock(tgP->decoderMutex);
+    return tgP->droppedFrames;
+}
+
+void ThermoGrabber::handOffFrame(uint32_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(tgP->decoderMutex);
+
+        if(tgP->freeCount==0)
+        {
+            // decoder too slow : the oldest waiting frame is dropped and its buffer reused
+            tgP->freeBuffers[tgP->freeCount++]=tgP->readyBuffers[tgP->readyFirst];
+            tgP->readyFirst=(tgP->readyFirst+1)%FRAME_BUFFER_COUNT;
+            tgP->readyCount--;
+            tgP->droppedFrames++;
+        }
+
+        const int last=(tgP->readyFirst+tgP->readyCount)%FRAME_BUFFER_COUNT;
+        tgP->readyBuffers[last]=tgP->framebuffer;
+        tgP->readySizes[last]=size;
+        tgP->readyUsbTimes[last]=tgP->frameUsbTime;
+        tgP->readyCount++;
+
+        tgP->framebuffer=tgP->freeBuffers[--tgP->freeCount];
+    }
+    tgP->decoderCond.notify_one();
+}
+
+void ThermoGrabber::decoderLoop()
+{
+    registerThread(tgP, true, true);
+
+    std::unique_lock<std::mutex> lock(tgP->decoderMutex);
+    while(true)
+    {
+        tgP->decoderCond.wait(lock,[this]{ return (tgP->readyCount>0) || !tgP->decoderRuns; });
+        if(tgP->readyCount==0)
+            break; // stopped and every frame has been given
+
+        uint16_t* buffer=tgP->readyBuffers[tgP->readyFirst];
+        const uint32_t size=tgP->readySizes[tgP->readyFirst];
+        tgP->decodedUsbTime=tgP->readyUsbTimes[tgP->readyFirst];
+        tgP->readyFirst=(tgP->readyFirst+1)%FRAME_BUFFER_COUNT;
+        tgP->readyCount--;
+
+        lock.unlock();
+        processVideoData(buffer,size);
+        lock.lock();
+
+        tgP->freeBuffers[tgP->freeCount++]=buffer;
+    }
+    lock.unlock();
+
+    registerThread(tgP, true, false);
+}
+
 void ThermoGrabber::reenableFTDI()
 {
     tgP->stop = 0;
+    std::lock_guard<std::mutex> lock(tgP->runMutex);
+    tgP->grabberFailed = false;
+}
+
+void ThermoGrabber::setStreamOptions(const thermal_grabber::StreamOptions& options)
+{
+    if (options.packetsPerTransfer == 0 || options.numTransfers == 0 || options.eventTimeoutUs == 0 ||
+        (options.adaptive && (options.minPacketsPerTransfer == 0 || options.targetTransferTimeUs == 0 ||
+                              options.minPacketsPerTransfer > options.packetsPerTransfer ||
+                              options.packetsPerTransfer > options.maxPacketsPerTransfer)))
+    {
+        std::cerr << "USB: Invalid stream options, the previous options are kept" << std::endl;
+        return;
+    }
+
+    tgP->streamOptions.packetsPerTransfer = options.packetsPerTransfer;
+    tgP->streamOptions.numTransfers = options.numTransfers;
+    tgP->streamOptions.eventTimeoutUs = options.eventTimeoutUs;
+    tgP->streamOptions.adaptive = options.adaptive;
+    tgP->streamOptions.minPacketsPerTransfer = options.minPacketsPerTransfer;
+    tgP->streamOptions.maxPacketsPerTransfer = options.maxPacketsPerTransfer;
+    tgP->streamOptions.targetTransferTime = options.targetTransferTimeUs * 1e-6;
+}
+
+bool ThermoGrabber::setThreadConfig(const thermal_grabber::ThreadConfig& usbEvents, const thermal_grabber::ThreadConfig& decoder)
+{
+    std::lock_guard<std::mutex> lock(tgP->threadMutex);
+    tgP->usbThreadConfig = usbEvents;
+    tgP->decoderThreadConfig = decoder;
+
+#ifdef __linux__
+    bool ok = true;
+    if (tgP->usbThreadRuns && !isDefaultConfig(usbEvents))
+        ok = applyThreadConfig(tgP->usbThreadId, usbEvents) && ok;
+    if (tgP->decoderThreadRuns && !isDefaultConfig(decoder))
+        ok = applyThreadConfig(tgP->decoderThreadId, decoder) && ok;
+    return ok;
+#else
+    if (isDefaultConfig(usbEvents) && isDefaultConfig(decoder))
+        return true;
+    std::cerr << "Thread: the configuration of the threads is not supported on this system" << std::endl;
+    return false;
+#endif
+}
+
+bool ThermoGrabber::waitGrabberRuns(unsigned int timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(tgP->runMutex);
+    tgP->runCond.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]{ return grabberRuns || tgP->grabberFailed; });
+    return grabberRuns;
+}
+
+void ThermoGrabber::setGrabberRuns(bool runs, bool failed)
+{
+    {
+        std::lock_guard<std::mutex> lock(tgP->runMutex);
+        grabberRuns = runs;
+        tgP->grabberFailed = failed;
+    }
+    tgP->runCond.notify_all();
 }
 
 void ThermoGrabber::stopGrabber()
@@ -69,17 +388,27 @@ void ThermoGrabber::stopGrabber()
 #ifdef USE_FTDI
 
     tgP->stop=1;
-    FT_Close(&tgP->dev);
+    if (tgP->devOpened)
+        FT_Close(&tgP->dev);
+    tgP->devOpened=false;
 
 #else
 
     tgP->stop=1;
-    FTDIDevice_Close(&tgP->dev);
+    if (tgP->devOpened)
+        FTDIDevice_Close(&tgP->dev);
+    tgP->devOpened=false;
 
 #endif
 
 }
 
+int ThermoGrabber::feedData(uint8_t* buffer, int length)
+{
+    startDecoder();
+    return readCallback(buffer, length, NULL);
+}
+
 int ThermoGrabber::static_readCallback(uint8_t *buffer, int length, void *progress, void *userdata)
 {
 
@@ -110,164 +439,113 @@ int ThermoGrabber::readCallback(uint8_t *buffer, int length, void *)
     tgP->byte_count+=length;
 	//std::cout << "ThermoGrabber callback (" << tgP->byte_count << ")" << std::endl;
 
-    for(int i=0;i<length;i++)
+    // The state machine searches 'TEAX' or 'UART' headers and the following bytes.
+    // Payloads and the bytes between packets are handled as blocks instead of byte by byte.
+    int i=0;
+    while(i<length)
     {
-        switch( tgP->parser_state) // state machine search 'TEAX' or 'UART' header and following bytes
+        switch( tgP->parser_state)
         {
 
         case 0:
         default:
 
-            if(buffer[i]=='T')
+            i+=findHeaderStart(buffer+i,length-i); // skip the bytes that can't start a header
+            if(i<length)
             {
-                tgP->parser_state=1;
-            }
-            else if(buffer[i]=='U')
-            {
-                tgP->parser_state=10;
-
+                tgP->parser_state=(buffer[i]=='T') ? 1 : 10;
+                i++;
             }
             break;
 
         case 1:
-
-            if (buffer[i]=='E')
-            {
-                tgP->parser_state=2;
-            }
-            else
-            {
-                tgP->parser_state=0;
-            }
-            break;
-
         case 2:
-
-            if(buffer[i]=='A')
-            {
-                tgP->parser_state=3;
-            }
-            else
-            {
-                tgP->parser_state=0;
-            }
-            break;
-
-
         case 3:
 
-            if(buffer[i]=='X')
-            {
-                tgP->parser_state=4;
-            }
-            else
-            {
-                tgP->parser_state=0;
-            }
+            // 'E', 'A', 'X' (a wrong byte is dropped with the partial header)
+            tgP->parser_state=(buffer[i]==teaxHeader[tgP->parser_state]) ? tgP->parser_state+1 : 0;
+            i++;
             break;
 
         case 4:
-            tgP->size=buffer[i];
-            tgP->parser_state=5;
-            break;
-
         case 5:
-            tgP->size|=buffer[i]<<8;
-            tgP->parser_state=6;
-            break;
-
         case 6:
-            tgP->size|=buffer[i]<<16;
-            tgP->parser_state=7;
-            break;
-
         case 7:
-            tgP->size|=buffer[i]<<24;
 
+            // size of the frame in 16 bit words, little endian
+            if(tgP->parser_state==4)
+                tgP->size=0;
+            tgP->size|=static_cast<int>(static_cast<uint32_t>(buffer[i])<<(8*(tgP->parser_state-4)));
+            i++;
+
+            if(tgP->parser_state<7)
+                tgP->parser_state++;
             // check for reasonable size of data frame
-            if ((tgP->size < MAX_FRAME_BUFFER_SIZE) && (tgP->size > MIN_FRAME_BUFFER_SIZE))
+            else if ((tgP->size < MAX_FRAME_BUFFER_SIZE) && (tgP->size > MIN_FRAME_BUFFER_SIZE))
+            {
                 tgP->parser_state=8;    // size ok -> go on
+                tgP->frameUsbTime=std::chrono::steady_clock::now(); // once per frame
+            }
             else
                 tgP->parser_state=0;    // reset state machine
             break;
 
         case 8:
-
-            if(tgP->bytecount>=(tgP->size*2))
+        {
+            const int missing=tgP->size*2-tgP->bytecount;
+            if(missing<=0)
             {
+                // the frame is complete, it is given on the byte following the payload (this byte is dropped)
 //                std::cout << "[Tau2] static cb " << std::chrono::duration_cast<std::chrono::duration<int64_t,std::micro>>(std::chrono::steady_clock::now().time_since_epoch()).count() << std::endl;
+                i++;
                 tgP->parser_state=0;
-                processVideoData(tgP->framebuffer, tgP->bytecount/2);
-                std::this_thread::sleep_for(std::chrono::microseconds(10000));//usleep(10000);
+                handOffFrame(tgP->bytecount/2); // decoded by the decoder thread, the parser goes on with another buffer
                 tgP->bytecount=0;
                 tgP->frames++;
             }
             else
             {
-                if((tgP->bytecount%2)==0)
-                {
-                    tgP->framebuffer[tgP->bytecount/2]=buffer[i];
-                }
-                else
-                {
-                    tgP->framebuffer[tgP->bytecount/2]|=buffer[i]<<8;
-                }
-                tgP->bytecount++;
+                const int count=std::min(missing,length-i);
+                copyPayload(tgP->framebuffer,tgP->bytecount,buffer+i,count);
+                tgP->bytecount+=count;
+                i+=count;
             }
             break;
+        }
 
         case 10:
-
-            if(buffer[i]=='A')
-            {
-                tgP->parser_state=11;
-            }
-            else
-            {
-                tgP->parser_state=0;
-            }
-            break;
-
         case 11:
-
-            if(buffer[i]=='R')
-            {
-                tgP->parser_state=12;
-            }
-            else
-            {
-                tgP->parser_state=0;
-            }
-            break;
-
         case 12:
 
-            if(buffer[i]=='T')
-            {
-                tgP->parser_state=13;
-            }
-            else
-            {
-                tgP->parser_state=0;
-            }
+            // 'A', 'R', 'T'
+            tgP->parser_state=(buffer[i]==uartHeader[tgP->parser_state-9]) ? tgP->parser_state+1 : 0;
+            i++;
             break;
 
         case 13:
             tgP->uart_in_size=buffer[i];
             tgP->uart_in_counter=0;
             tgP->parser_state=14;
+            i++;
             break;
 
         case 14:
-            tgP->uart_in_buffer[tgP->uart_in_counter++]=buffer[i];
-
-            if((tgP->uart_in_counter+1)>=tgP->uart_in_size)
+        {
+            // the last byte announced by the size is not part of the packet, but at least one byte is read
+            const int expected=std::max(1,tgP->uart_in_size-1);
+            const int count=std::min(expected-tgP->uart_in_counter,length-i);
+            memcpy(tgP->uart_in_buffer+tgP->uart_in_counter,buffer+i,count);
+            tgP->uart_in_counter+=count;
+            i+=count;
+
+            if(tgP->uart_in_counter>=expected)
             {
                 processUartData(tgP->uart_in_buffer,tgP->uart_in_size);
                 tgP->parser_state=0;
             }
             break;
         }
+        }
     }
     return tgP->stop;
 }
@@ -282,8 +560,10 @@ int ThermoGrabber::runGrabber(const char* iSerialUSB)
     if (err)
     {
         std::cerr <<  "USB: Error opening device" << std::endl;
+        setGrabberRuns(false, true);
         return 1;
     }
+    tgP->devOpened=true;
 
     err = FTDIDevice_SetMode(&(tgP->dev),
                              FTDI_INTERFACE_A,
@@ -293,6 +573,7 @@ int ThermoGrabber::runGrabber(const char* iSerialUSB)
     if (err)
     {
         std::cerr << "USB: Error SetMode\n";
+        setGrabberRuns(false, true);
         return 1;
     }
 
@@ -301,14 +582,18 @@ int ThermoGrabber::runGrabber(const char* iSerialUSB)
 //                             0x00); // Cmd: NO_OP
 
     // Now TG usb setup is done
-    grabberRuns = true;
+    startDecoder();
+    setGrabberRuns(true, false);
+
+    registerThread(tgP, false, true); // this thread handles the USB events until the stream stops
+
+    err = FTDIDevice_ReadStreamOptions(&(tgP->dev), // dev
+                                       FTDI_INTERFACE_A, // interface
+                                       (int (*)(uint8_t*, int, FTDIProgressInfo*, void*))static_readCallback,
+                                       this, // userdata
+                                       &tgP->streamOptions);
 
-    err = FTDIDevice_ReadStream(&(tgP->dev), // dev
-                                FTDI_INTERFACE_A, // interface
-                                (int (*)(uint8_t*, int, FTDIProgressInfo*, void*))static_readCallback,
-                                this, // userdata
-                                8, // packetsPerTransfer
-                                256); // numTransfers
+    registerThread(tgP, false, false);
 
     //-------------------------------------------------------------------------
     // TEST
@@ -338,7 +623,8 @@ int ThermoGrabber::runGrabber(const char* iSerialUSB)
 //#endif
 
 
-    grabberRuns = false;
+    stopDecoder(); // the frames already received are still given
+    setGrabberRuns(false, false);
 
     //---------------------------------------------------------
     // This has to be enabled if working without watchdog!!!
@@ -1,4 +1,6 @@
 #include <inttypes.h>
+#include <chrono>
+#include <thermalgrabber.h>
 
 class ThermoGrabberPrivate;
 
@@ -23,14 +25,36 @@ public:
     // Becomes true if ThermoGrabber begins
     bool grabberRuns;
 
+    //Waits until runGrabber has set up the USB connection (returns true) or failed to (returns false)
+    bool waitGrabberRuns(unsigned int timeoutMs);
+
     void reenableFTDI();
 
+    //Options of the USB stream, used by the next calls of runGrabber (see thermal_grabber::StreamOptions)
+    void setStreamOptions(const thermal_grabber::StreamOptions& options);
+
+    //Scheduling of the thread running runGrabber (USB events) and of the decoder thread (see thermal_grabber::ThreadConfig)
+    //Applied to the running threads and to the threads started later, returns false if a setting could not be applied
+    bool setThreadConfig(const thermal_grabber::ThreadConfig& usbEvents, const thermal_grabber::ThreadConfig& decoder);
+
+    //Parses a block of bytes as if it had been received from the USB hardware (used by tests and benchmarks)
+    //The frames are given asynchronously by the decoder thread, call stopDecoder to wait for them
+    int feedData(uint8_t* buffer, int length);
+
+    //The video frames are given to processVideoData by a decoder thread, started by runGrabber or feedData.
+    //stopDecoder waits until the received frames have been given. A derived class has to call it in its destructor.
+    void startDecoder();
+    void stopDecoder();
+
+    //Number of frames dropped because the decoder was too slow
+    unsigned int getDroppedFrames();
+
 protected:
 
     //This function is called when UART data was received
     virtual void processUartData(uint8_t* buffer,uint32_t size)=0;
 
-    //This function is called when a video frame was received
+    //This function is called when a video frame was received (from the decoder thread)
     //Data is encoded in 16 bit words:
     //Bit 15 HSYNC //0 between lines, 1 if pixel data is valid
     //Bit 14 VSYNC //0 between frames, 1 if lines are valid
@@ -39,12 +63,18 @@ protected:
 
     unsigned int getPPSTimestamp();
 
+    //Arrival time of the first USB payload of the frame given to processVideoData (only valid during the call)
+    std::chrono::steady_clock::time_point getFrameUsbTime();
+
 private:
 
     ThermoGrabberPrivate* tgP;
     static int static_readCallback(uint8_t *buffer, int length, void *progress, void *userdata);
     int readCallback(uint8_t *buffer, int length, void *progress);
     void writeUartHeader(uint8_t* buffer,uint8_t dataSize);
+    void handOffFrame(uint32_t size);
+    void decoderLoop();
+    void setGrabberRuns(bool runs, bool failed);
 
     unsigned int mPPSTimestamp;
 
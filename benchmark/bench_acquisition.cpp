@@ -0,0 +1,87 @@
+#include "bench_util.hpp"
+
+#include "acquisition.hpp"
+#include "camera_synthetic.hpp"
+
+#include <string>
+#include <vector>
+
+//Handoff between the acquisition thread and the caller, measured with synthetic cameras (no hardware needed).
+//The latency is the time between the reception of the first image of a set (host_tp) and the return of get_frames.
+namespace
+{
+
+void setup(cam::Acquisition& acq, int cam_number, int width, int height, double rate_hz)
+{
+	for(int i = 0; i < cam_number; ++i)
+	{
+		acq.add_camera<cam::synthetic>("bench_" + std::to_string(i));
+		cam::SyntheticParameters& params = dynamic_cast<cam::SyntheticParameters&>(acq.get_cam_params(i));
+		params.set_image_format(width, height, CV_8UC1);
+		params.set_rate(rate_hz);
+		params.set_latency(0);
+	}
+}
+
+void bench_handoff(cam::Bench_runner& runner, int cam_number, bool parallel, size_t samples)
+{
+	const std::string name = "handoff_latency/cams:" + std::to_string(cam_number) + (parallel ? "/parallel" : "/sequential");
+	if(!runner.enabled(name)) return;
+	samples = runner.scaled(samples);
+
+	cam::Acquisition acq;
+	setup(acq, cam_number, 752, 480, 1000.0);
+	acq.set_parallel_retrieval(parallel);
+	acq.start_acq();
+
+	std::vector<double> times_ns;
+	times_ns.reserve(samples);
+	cam::Frame_set_ptr frame_set;
+	const uint64_t allocs_start = cam::bench_allocation_count();
+	const uint64_t bytes_start = cam::bench_allocated_bytes();
+	while(times_ns.size() < samples && acq.is_running())
+	{
+		if(acq.get_frames(frame_set) < 0) continue;
+		const cam::clock_type::time_point now = cam::clock_type::now();
+		times_ns.push_back(std::chrono::duration<double, std::nano>(now - frame_set->frame_info[0].host_tp).count());
+		frame_set.reset();//Give the set back to the pool as soon as possible, as a real consumer would
+	}
+	const double iterations = times_ns.empty() ? 1.0 : static_cast<double>(times_ns.size());
+	const uint64_t allocs = cam::bench_allocation_count() - allocs_start;//Includes the allocations of the acquisition thread
+	const uint64_t bytes = cam::bench_allocated_bytes() - bytes_start;
+	acq.stop_acq();
+
+	runner.add(name, times_ns, allocs / iterations, bytes / iterations);
+}
+
+void bench_get_images(cam::Bench_runner& runner, int cam_number, size_t samples)
+{
+	const std::string name = "get_images/cams:" + std::to_string(cam_number);
+	if(!runner.enabled(name)) return;
+
+	cam::Acquisition acq;
+	setup(acq, cam_number, 752, 480, 1000.0);
+	acq.start_acq();
+
+	std::vector<cv::Mat> images;
+	runner.run(name, samples, 1, [&acq, &images]() { acq.get_images(images); });//Waiting for the set + copy of the images
+
+	acq.stop_acq();
+}
+
+} //namespace
+
+//Usage : bench_acquisition [--filter=substring] [--json=file] [--iterations_scale=factor]
+int main(int argc, char** argv)
+{
+	cam::Bench_runner runner(argc, argv);
+
+	for(int cam_number = 1; cam_number <= 4; cam_number *= 2)
+	{
+		bench_handoff(runner, cam_number, false, 2000);
+		bench_handoff(runner, cam_number, true, 2000);
+		bench_get_images(runner, cam_number, 2000);
+	}
+
+	return runner.finish();
+}
@@ -0,0 +1,202 @@
+#include "bench_util.hpp"
+
+#include "tone_mapper.hpp"
+
+#include "crc.h"
+#include "tauimagedecoder.h"
+#include "thermograbber.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Hot paths of the Tau2 driver, fed with synthetic data (no grabber needed) :
+//parsing of the USB stream, decoding of the frames, conversion to 8 bits and CRC of the UART packets.
+namespace
+{
+
+constexpr unsigned int tau_width = 640;
+constexpr unsigned int tau_height = 512;
+
+//Words of a frame as sent by the grabber : the PPS counter, then the pixels with the HSYNC and VSYNC bits set
+std::vector<uint16_t> make_frame_words(unsigned int width, unsigned int height)
+{
+	std::vector<uint16_t> words;
+	words.reserve(width * height + 1);
+	words.push_back(0x0123);//PPS value (top bits 00)
+	for(unsigned int i = 0; i < width * height; ++i)
+	{
+		words.push_back(0xC000 | static_cast<uint16_t>((7000 + i * 13) & 0x3FFF));
+	}
+	return words;
+}
+
+//USB stream of a frame : "TEAX", number of words (little endian), words, and one byte consumed when the frame ends
+void append_frame_packet(std::vector<uint8_t>& stream, const std::vector<uint16_t>& words)
+{
+	const uint32_t size = static_cast<uint32_t>(words.size());
+	stream.insert(stream.end(), {'T', 'E', 'A', 'X'});
+	for(int b = 0; b < 4; ++b) stream.push_back(static_cast<uint8_t>(size >> (8 * b)));
+	for(uint16_t w : words)
+	{
+		stream.push_back(static_cast<uint8_t>(w & 0xFF));
+		stream.push_back(static_cast<uint8_t>(w >> 8));
+	}
+	stream.push_back(0);
+}
+
+//UART packet as sent by the grabber : "UART", size, data
+void append_uart_packet(std::vector<uint8_t>& stream, const std::vector<uint8_t>& data)
+{
+	stream.insert(stream.end(), {'U', 'A', 'R', 'T'});
+	stream.push_back(static_cast<uint8_t>(data.size()));
+	stream.insert(stream.end(), data.begin(), data.end());
+}
+
+class Bench_decoder : public TauImageDecoder
+{
+	public:
+	Bench_decoder(unsigned int width, unsigned int height) : frames(0)
+	{
+		mTauCoreResWidth = width;
+		mTauCoreResHeight = height;
+	}
+
+	void frameDecoded(TauRawBitmap* /*frame*/) override
+	{
+		++frames;
+	}
+
+	unsigned int frames;
+}; //class Bench_decoder
+
+class Bench_grabber : public ThermoGrabber
+{
+	public:
+	Bench_grabber() : video_frames(0), uart_packets(0) {}
+
+	~Bench_grabber()
+	{
+		stopDecoder();
+	}
+
+	unsigned int video_frames;
+	unsigned int uart_packets;
+
+	protected:
+	void processUartData(uint8_t* /*buffer*/, uint32_t /*size*/) override { ++uart_packets; }
+	void processVideoData(uint16_t* /*buffer*/, uint32_t /*size*/) override { ++video_frames; }
+}; //class Bench_grabber
+
+void bench_parser(cam::Bench_runner& runner, const std::vector<uint16_t>& words, size_t chunk_size)
+{
+	//The stream is cut in chunks as the USB transfers would be. A sample is one frame with a few UART packets around it.
+	std::vector<uint8_t> stream;
+	append_uart_packet(stream, {0x6E, 0, 0, 0x0A, 0, 4, 0x12, 0x34, 0, 0, 0, 0, 0x56, 0x78});
+	append_frame_packet(stream, words);
+	append_uart_packet(stream, {0x6E, 0, 0, 0x0A, 0, 4, 0x12, 0x34, 0, 0, 0, 0, 0x56, 0x78});
+
+	Bench_grabber grabber;
+	runner.run("parser/chunk:" + std::to_string(chunk_size), 20, 1, [&grabber, &stream, chunk_size]()
+	{
+		for(size_t offset = 0; offset < stream.size(); offset += chunk_size)
+		{
+			const int length = static_cast<int>(std::min(chunk_size, stream.size() - offset));
+			grabber.feedData(stream.data() + offset, length);
+		}
+	});
+
+	grabber.stopDecoder();//Wait for the frames given to the decoder thread
+	if(runner.enabled("parser/chunk:" + std::to_string(chunk_size)) && grabber.video_frames == 0)
+	{
+		std::cerr << "The parser did not find any frame in the stream" << std::endl;
+	}
+}
+
+//Conversion previously done in the Tau2 callback, kept as a baseline for the tone mapper
+void convert_8bit_opencv(const cv::Mat& img16, cv::Mat& img8)
+{
+	const double gain = cam::tone_linear_gain_d;
+	const double mean = cv::mean(img16)[0];
+	img16.convertTo(img8, CV_8U, gain, 127 - mean * gain);
+}
+
+//Bit by bit CRC previously used by the driver (augmented CRC-CCITT), kept as a baseline for calc_crc
+unsigned short calc_crc_bitwise(const unsigned char* data, int len)
+{
+	unsigned int crc = 0;
+	for(int i = 0; i < len + 2; ++i)//The 2 zero bytes augment the message
+	{
+		const unsigned char byte = i < len ? data[i] : 0;
+		for(int bit = 7; bit >= 0; --bit)
+		{
+			const bool msb = crc & 0x8000;
+			crc = ((crc << 1) | ((byte >> bit) & 1)) & 0xFFFF;
+			if(msb) crc ^= 0x1021;
+		}
+	}
+	return static_cast<unsigned short>(crc);
+}
+
+} //namespace
+
+//Usage : bench_tau2 [--filter=substring] [--json=file] [--iterations_scale=factor]
+int main(int argc, char** argv)
+{
+	cam::Bench_runner runner(argc, argv);
+
+	const std::vector<uint16_t> words = make_frame_words(tau_width, tau_height);
+
+	//Stream parsing, on the USB thread (the frames are handed off to the decoder thread)
+	bench_parser(runner, words, 16384);
+	bench_parser(runner, words, 512);
+
+	//Frame decoding, from the frame buffer of the parser as TauInterface does
+	{
+		Bench_decoder decoder(tau_width, tau_height);
+		runner.run("decode/640x512", 200, 1, [&decoder, &words]() { decoder.decodeData(words.data(), static_cast<unsigned int>(words.size())); });
+
+		decoder.setROI(0, 16, 640, 480);//ROI used by the examples
+		runner.run("decode/640x512/roi:640x480", 200, 1, [&decoder, &words]() { decoder.decodeData(words.data(), static_cast<unsigned int>(words.size())); });
+	}
+
+	//Conversion of the 16 bits images to 8 bits, done when a CV_8U frame is retrieved from the Tau2
+	{
+		cv::Mat img16(tau_height, tau_width, CV_16UC1);
+		for(int r = 0; r < img16.rows; ++r)
+		{
+			uint16_t* row = img16.ptr<uint16_t>(r);
+			for(int c = 0; c < img16.cols; ++c) row[c] = static_cast<uint16_t>(7000 + ((r * 31 + c * 7) & 0x3FF));
+		}
+		cv::Mat img8;
+		runner.run("convert_8bit/opencv/640x512", 500, 1, [&img16, &img8]() { convert_8bit_opencv(img16, img8); });
+
+		cam::Tone_mapper tone_mapper;
+		const std::pair<cam::Tone_mapping, std::string> modes[] = {{cam::tone_linear, "linear"}, {cam::tone_min_max, "min_max"},
+																	{cam::tone_histogram, "histogram"}, {cam::tone_plateau, "plateau"}};
+		for(const auto& mode : modes)
+		{
+			tone_mapper.set_mode(mode.first);
+			runner.run("tone_map/" + mode.second + "/640x512", 500, 1, [&tone_mapper, &img16, &img8]() { tone_mapper.apply(img16, img8); });
+		}
+	}
+
+	//CRC of the UART packets
+	for(size_t size : {size_t(64), size_t(1024)})
+	{
+		std::vector<unsigned char> message(size);
+		for(size_t i = 0; i < size; ++i) message[i] = static_cast<unsigned char>(i * 17 + 3);
+		volatile unsigned short crc = 0;
+		runner.run("crc/" + std::to_string(size), 1000, 100, [&message, &crc]() { crc = calc_crc(message.data(), static_cast<int>(message.size())); });
+		runner.run("crc_bitwise/" + std::to_string(size), 1000, 100, [&message, &crc]() { crc = calc_crc_bitwise(message.data(), static_cast<int>(message.size())); });
+		if(runner.enabled("crc") && calc_crc(message.data(), static_cast<int>(message.size())) != calc_crc_bitwise(message.data(), static_cast<int>(message.size())))
+		{
+			std::cerr << "The CRC differs from the bitwise implementation" << std::endl;
+		}
+	}
+
+	return runner.finish();
+}
@@ -0,0 +1,186 @@
+#include "bench_util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+#include <malloc.h>
+
+//Allocation counting : operator new goes through malloc, so counting the malloc family is enough and also
+//covers the C allocations (e.g. cv::fastMalloc uses posix_memalign). The glibc functions are called directly.
+static std::atomic<uint64_t> allocation_count(0);
+static std::atomic<uint64_t> allocated_bytes(0);
+
+#ifdef __GLIBC__
+extern "C" {
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t number, size_t size);
+void * __libc_realloc(void * ptr, size_t size);
+void * __libc_memalign(size_t alignment, size_t size);
+
+static inline void count_allocation(size_t size)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void * malloc(size_t size)
+{
+	count_allocation(size);
+	return __libc_malloc(size);
+}
+
+void * calloc(size_t number, size_t size)
+{
+	count_allocation(number * size);
+	return __libc_calloc(number, size);
+}
+
+void * realloc(void * ptr, size_t size)
+{
+	count_allocation(size);
+	return __libc_realloc(ptr, size);
+}
+
+void * memalign(size_t alignment, size_t size)
+{
+	count_allocation(size);
+	return __libc_memalign(alignment, size);
+}
+
+void * aligned_alloc(size_t alignment, size_t size)
+{
+	count_allocation(size);
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void ** ptr, size_t alignment, size_t size)
+{
+	count_allocation(size);
+	void * result = __libc_memalign(alignment, size);
+	if(!result) return ENOMEM;
+	*ptr = result;
+	return 0;
+}
+} //extern "C"
+#else
+#warning "Allocation counting is only implemented with the glibc, the allocations will be reported as 0."
+#endif
+
+namespace cam {
+
+uint64_t bench_allocation_count()
+{
+	return allocation_count.load();
+}
+
+uint64_t bench_allocated_bytes()
+{
+	return allocated_bytes.load();
+}
+
+Bench_runner::Bench_runner(int argc, char** argv) : iterations_scale(1.0), program(argc > 0 ? argv[0] : "")
+{
+	for(int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if(arg.compare(0, 9, "--filter=") == 0) filter = arg.substr(9);
+		else if(arg.compare(0, 7, "--json=") == 0) json_file = arg.substr(7);
+		else if(arg.compare(0, 19, "--iterations_scale=") == 0) iterations_scale = std::max(std::atof(arg.c_str() + 19), 0.0);
+		else std::cerr << "Unknown option " << arg << ", usage : " << program << " [--filter=substring] [--json=file] [--iterations_scale=factor]" << std::endl;
+	}
+}
+
+bool Bench_runner::enabled(const std::string& name) const
+{
+	return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+size_t Bench_runner::scaled(size_t samples) const
+{
+	return std::max<size_t>(1, static_cast<size_t>(samples * iterations_scale));
+}
+
+void Bench_runner::add(const std::string& name, std::vector<double> times_ns, double allocs_per_iter, double bytes_per_iter)
+{
+	if(times_ns.empty()) return;
+	std::sort(times_ns.begin(), times_ns.end());
+
+	auto percentile = [&times_ns](double p)
+	{
+		const size_t idx = std::min(times_ns.size() - 1, static_cast<size_t>(p * (times_ns.size() - 1) + 0.5));
+		return times_ns[idx];
+	};
+
+	double sum = 0;
+	for(double t : times_ns) sum += t;
+
+	Bench_result result;
+	result.name = name;
+	result.iterations = times_ns.size();
+	result.mean_ns = sum / times_ns.size();
+	result.p50_ns = percentile(0.5);
+	result.p90_ns = percentile(0.9);
+	result.p99_ns = percentile(0.99);
+	result.max_ns = times_ns.back();
+	result.allocs_per_iter = allocs_per_iter;
+	result.bytes_per_iter = bytes_per_iter;
+	result.items_per_second = result.mean_ns > 0 ? 1e9 / result.mean_ns : 0;
+	results.push_back(result);
+
+	std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(1)
+			<< " mean " << std::setw(12) << result.mean_ns << " ns"
+			<< "  p50 " << std::setw(12) << result.p50_ns
+			<< "  p99 " << std::setw(12) << result.p99_ns
+			<< "  max " << std::setw(12) << result.max_ns
+			<< "  allocs/it " << std::setprecision(2) << result.allocs_per_iter
+			<< "  bytes/it " << std::setprecision(0) << result.bytes_per_iter << std::endl;
+}
+
+int Bench_runner::finish()
+{
+	if(json_file.empty()) return 0;
+
+	std::ofstream out(json_file);
+	if(!out.is_open())
+	{
+		std::cerr << "Cannot write " << json_file << std::endl;
+		return 1;
+	}
+
+	char date[32];
+	const std::time_t now = std::time(nullptr);
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+	//Same layout as the JSON output of Google Benchmark, so the usual comparison tools can be used
+	out << std::setprecision(6) << std::fixed;
+	out << "{\n  \"context\": {\n    \"date\": \"" << date << "\",\n    \"executable\": \"" << program << "\"\n  },\n  \"benchmarks\": [\n";
+	for(size_t i = 0; i < results.size(); ++i)
+	{
+		const Bench_result& r = results[i];
+		out << "    {\n"
+			<< "      \"name\": \"" << r.name << "\",\n"
+			<< "      \"iterations\": " << r.iterations << ",\n"
+			<< "      \"real_time\": " << r.mean_ns << ",\n"
+			<< "      \"cpu_time\": " << r.mean_ns << ",\n"
+			<< "      \"time_unit\": \"ns\",\n"
+			<< "      \"p50\": " << r.p50_ns << ",\n"
+			<< "      \"p90\": " << r.p90_ns << ",\n"
+			<< "      \"p99\": " << r.p99_ns << ",\n"
+			<< "      \"max\": " << r.max_ns << ",\n"
+			<< "      \"allocs_per_iter\": " << r.allocs_per_iter << ",\n"
+			<< "      \"bytes_per_iter\": " << r.bytes_per_iter << ",\n"
+			<< "      \"items_per_second\": " << r.items_per_second << "\n"
+			<< "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+
+	return 0;
+}
+
+} //namespace cam
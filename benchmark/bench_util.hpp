@@ -0,0 +1,80 @@
+#ifndef UASL_IMAGE_ACQUISITION_BENCH_UTIL_HPP
+#define UASL_IMAGE_ACQUISITION_BENCH_UTIL_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cam {
+
+//Allocation counters, incremented by the allocation functions replaced in bench_util.cpp (operator new and the malloc family)
+uint64_t bench_allocation_count();
+uint64_t bench_allocated_bytes();
+
+struct Bench_result
+{
+	std::string name;
+	size_t iterations;//Number of operations measured
+	double mean_ns;//Statistics of the time of a single operation
+	double p50_ns;
+	double p90_ns;
+	double p99_ns;
+	double max_ns;
+	double allocs_per_iter;
+	double bytes_per_iter;
+	double items_per_second;//Operations per second, 0 if not relevant
+};
+
+class Bench_runner
+{
+	//Minimal harness for the benchmarks : each sample is timed separately to get the percentiles, the allocations
+	//are counted over the whole run, and the results are printed as a table and optionally written in JSON.
+	//Command line : [--filter=substring] [--json=file] [--iterations_scale=factor]
+	public:
+	Bench_runner(int argc, char** argv);
+
+	bool enabled(const std::string& name) const;//False if the benchmark is excluded by the filter
+
+	//Time samples calls of body, each sample running batch calls (use a batch for operations shorter than a microsecond)
+	template <typename F>
+	void run(const std::string& name, size_t samples, size_t batch, F body)
+	{
+		if(!enabled(name)) return;
+		samples = scaled(samples);
+
+		body();//Warm up (first allocations, caches)
+
+		std::vector<double> times_ns;
+		times_ns.reserve(samples);
+		const uint64_t allocs_start = bench_allocation_count();
+		const uint64_t bytes_start = bench_allocated_bytes();
+		for(size_t s = 0; s < samples; ++s)
+		{
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for(size_t b = 0; b < batch; ++b) body();
+			const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			times_ns.push_back(std::chrono::duration<double, std::nano>(end - start).count() / batch);
+		}
+		const double iterations = static_cast<double>(samples * batch);
+		add(name, times_ns, (bench_allocation_count() - allocs_start) / iterations, (bench_allocated_bytes() - bytes_start) / iterations);
+	}
+
+	//Add a result measured by the caller (e.g. a latency between two threads)
+	void add(const std::string& name, std::vector<double> times_ns, double allocs_per_iter, double bytes_per_iter);
+
+	size_t scaled(size_t samples) const;//Number of samples after applying --iterations_scale
+
+	int finish();//Print the results, write the JSON file, returns 0 on success
+
+	private:
+	std::vector<Bench_result> results;
+	std::string filter;
+	std::string json_file;
+	double iterations_scale;
+	std::string program;
+}; //class Bench_runner
+
+} //namespace cam
+
+#endif
@@ -15,19 +15,22 @@
 #include "camera_tau2.hpp" //You need the header corresponding to the specific camera you are using
 #include "camera_mvbluefox.hpp"
 #include "util_signal.hpp" //For the signal handling
+#include "recorder.hpp" //For the raw recording
 
 
 struct{
 
 std::string dir;
 bool save=false;
+std::string record_file;//Raw recording (much faster than the PNG files)
+bool direct_io=false;
 
 }params;
 
 int main(int argc, char** argv)
 {
     char c;
-    while ((c = getopt(argc, argv, "sd:")) != -1)
+    while ((c = getopt(argc, argv, "sd:r:o")) != -1)
 	{
 		switch (c)
 		{
@@ -35,6 +38,10 @@ int main(int argc, char** argv)
             params.dir = optarg;break;
         case 's':
             params.save=true;break;
+        case 'r':
+            params.record_file = optarg;break;
+        case 'o':
+            params.direct_io=true;break;
 		default:
 			std::cout << "Invalid option: -" << c << std::endl;
 			return 1;
@@ -67,8 +74,28 @@ int main(int argc, char** argv)
 
     //start acquisition
 	acq.set_trigger_port_name("/dev/ttyTRIGGER");
+	acq.set_parallel_retrieval(true);//One retrieval thread per camera, the slow Tau2 does not delay the BlueFOX anymore
     acq.start_acq();
 
+	if(!params.record_file.empty())
+	{
+		//The images are written as they are by the thread of the recorder, nothing is copied or encoded here
+		cam::Recorder recorder(params.record_file, params.direct_io);
+		if(!recorder.is_open()) return -1;
+
+		cam::Frame_set_ptr frame_set;
+		while(sig_handle.check_term_sig() && acq.is_running())
+		{
+			if(acq.get_frames(frame_set) > 0)
+                recorder.record(frame_set);
+			else
+                std::cerr << "[Error] could not retreive images" << std::endl;
+		}
+		recorder.close();
+		std::cout << recorder.get_written_sets() << " sets recorded, " << recorder.get_dropped_sets() << " dropped." << std::endl;
+		return 0;
+	}
+
 	unsigned int img_nb = 0;
 	while(sig_handle.check_term_sig() && acq.is_running())
 	{
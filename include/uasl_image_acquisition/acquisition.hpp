@@ -3,7 +3,13 @@
 
 #include "camera_sequential.hpp"
 #include "cond_var_package.hpp"
+#include "frame_pool.hpp"
+#include "frame_ring.hpp"
+#include "retrieval_worker.hpp"
+#include "frame_synchronizer.hpp"
+#include "latency_stats.hpp"
 #include "util_clock.hpp"
+#include "util_thread.hpp"
 #include "trigger.hpp"
 
 #include <vector>
@@ -31,6 +37,12 @@ static constexpr int timeout_delay_ms = 5000;//Timeout value in milliseconds for
 
 static constexpr char default_cam_id[] = "";//Default id value for the camera
 
+static constexpr int64_t sync_max_wait_us = 500000;//Time after which an incomplete set is dropped or padded even if the late camera did not send any newer image
+static constexpr int trigger_retry_ms = 100;//Time before a new attempt to configure the free running trigger
+static constexpr int trigger_max_failures = 10;//Consecutive failures of the configuration of the free running trigger after which the acquisition is aborted
+
+static constexpr size_t default_ring_depth = 1;//Depth of the ring used by get_images/get_frames (only the latest set is kept)
+
 static const std::string port_name_d = "/dev/ttyTRIGGER";//Default name of the VCP port for the trigger
 #ifdef __unix__
 static constexpr speed_t baudrate_d = B115200;//Default baudrate for the trigger
@@ -53,10 +65,7 @@ class Acquisition
 		//This function has to be in the header due to the template
 		stop_acq();//Start by stopping any acquisition
 
-		//Lock both the camera and image vectors at the same time
-		std::unique_lock<std::mutex> lock_cam(camera_vec_mtx, std::defer_lock);
-		std::unique_lock<std::mutex> lock_img(images_vec_mtx, std::defer_lock);
-		std::lock(lock_cam, lock_img);
+		std::lock_guard<std::mutex> lock_cam(camera_vec_mtx);
 
 		std::unique_ptr<Camera_seq> cam_ptr = nullptr;
 
@@ -75,7 +84,7 @@ class Acquisition
 		if(cam_ptr)
 		{
 			camera_vec.push_back(std::move(cam_ptr));
-			images_vec.resize(camera_vec.size());
+			clear_rings();//The waiting sets do not match the camera vector anymore
 		}
 		else
 		{
@@ -87,9 +96,22 @@ class Acquisition
 	}
 
 
-	Camera_params& get_cam_params(size_t idx);//Get the parameters of a specific camera to modify them (stops the acquisition)
+	Camera_params& get_cam_params(size_t idx);//Get the parameters of a specific camera to modify them (the modifications are applied between two frames, see post_param_command)
+
+	//Parameters modifications given by the cameras (see Camera_params::post_command), applied between two frames by the acquisition thread.
+	void post_param_command(const Param_command& command);
+	bool wait_param_commands(int timeout_ms);//Wait until all the modifications posted before the call are applied, returns false in case of timeout
+
+	int64_t get_images(std::vector<cv::Mat>& img_vec);//Get an image from each camera (the images are copied)
+	int64_t get_frames(Frame_set_ptr& frame_set);//Get an image from each camera without any copy (see Frame_set_ptr for the lifetime of the images)
+
+	//Create an additional ring receiving every set published by the acquisition, with its own depth and overflow policy.
+	//Each consumer should use its own ring (with Frame_ring::pop), the rings are independent from each other and from get_frames.
+	//Please note that a ring with the block_producer policy slows down the acquisition for all the consumers when it is full.
+	std::shared_ptr<Frame_ring> subscribe(size_t depth, Overflow_policy policy = overwrite_oldest);
+	void unsubscribe(const std::shared_ptr<Frame_ring>& ring);
 
-	int64_t get_images(std::vector<cv::Mat>& img_vec);//Get an image from each camera
+	uint64_t get_dropped_sets();//Number of sets lost by get_images/get_frames because the caller was too slow
 
 	#ifdef __unix__
 	speed_t get_trigger_baurate() const;
@@ -99,6 +121,43 @@ class Acquisition
 	std::string get_trigger_port_name();
 	void set_trigger_port_name(const std::string& portname);
 
+	//Trigger used when several cameras need one (stops the acquisition) : serial device (Trigger_vcp), GPIO line of the host (Trigger_gpio)
+	//or in-process loopback for the synthetic cameras (Trigger_loopback). nullptr (default) uses a Trigger_vcp on the trigger port name and baudrate.
+	std::shared_ptr<Trigger> get_trigger();
+	void set_trigger(const std::shared_ptr<Trigger>& trigger);
+	uint64_t get_lost_triggers() const;//Number of triggers not acknowledged by the trigger device (see Trigger_vcp)
+	Trigger_round_trip get_trigger_round_trip() const;//Latency of the serial link to the trigger device, measured when the acquisition opens it
+
+	//Free running trigger : if the period is not 0, the trigger device generates a pulse every period_us by itself, instead of one pulse per set sent by the acquisition thread.
+	//The acquisition thread then only assembles the images into sets, so that the exposure of the next images overlaps with the retrieval of the current ones.
+	//The period can be changed during the acquisition, and has to be shorter than the retrieval timeout of the cameras. 0 (default) goes back to one trigger per set.
+	//A camera missing a pulse shifts the sets : use a synchronization tolerance (set_sync_tolerance_us) to match the images by timestamp.
+	uint32_t get_trigger_period_us() const;
+	void set_trigger_period_us(uint32_t period_us);
+
+	//If true, each camera gets its own retrieval thread when several cameras are used (stops the acquisition).
+	//The set is then ready when the slowest camera is done, instead of after the sum of the retrieval times.
+	bool get_parallel_retrieval() const;
+	void set_parallel_retrieval(bool parallel);
+
+	//Assemble the sets according to the timestamps of the images (see Frame_synchronizer) when several cameras are used (stops the acquisition).
+	//The images of a set are within tolerance_us of each other. A tolerance of 0 disables the synchronizer : the images are then matched by order of arrival.
+	int64_t get_sync_tolerance_us() const;
+	void set_sync_tolerance_us(int64_t tolerance_us, Straggler_policy policy = drop_incomplete);
+	uint64_t get_sync_dropped_frames() const;//Number of images discarded by the synchronizer since the start of the acquisition
+
+	//Pinning and scheduling of the acquisition threads and of the threads of the camera drivers (stops the acquisition, see Thread_policy).
+	//The policy is applied at the start of each acquisition : the acquisition and retrieval threads are configured when they start,
+	//and the policy is given to every camera (Camera_seq::set_thread_policy).
+	Thread_policy get_thread_policy();
+	void set_thread_policy(const Thread_policy& policy);
+
+	//Latency of each stage of the pipeline since the start of the acquisition (see Latency_stats). Can be called during the acquisition.
+	Latency_summary get_latency(Latency_stage stage) const;
+	void print_latency(std::ostream& stream) const;
+	void reset_latency();
+	void set_latency_report_period(int period_ms);//The acquisition thread prints the latencies on std::cout every period_ms, 0 to disable (default)
+
 	private:
 
     std::vector<std::unique_ptr<Camera_seq>> camera_vec;//Vector holding the cameras
@@ -111,26 +170,57 @@ class Acquisition
 
 	Cond_var_package acq_start_package;//Structure which manages the locking/unlocking of the possibility to start an acquisition. value is true if the acquisition can start, false otherwise (each operation preventing the acquisition uses this variable to start, so set this to false by using cv if you want to prevent the acquisition from starting). Please note that note that several operations can use this structure (e.g. each modification of a parameter)
 
-	std::vector<cv::Mat> images_vec;//Vector holding the images
-	std::mutex images_vec_mtx;//Mutex protecting the vector of images
+	Frame_pool frame_pool;//Pool of recycled sets of images, filled by the acquisition thread
+	uint64_t next_seq;//Sequence number of the next set published (only used by the acquisition thread)
 
-	std::condition_variable images_have_changed;//Notification when a new set of images is registered
-    bool images_have_been_returned;//If the current set of images have been used
-    std::mutex images_ready_mtx;//Mutex to protect images_have_been_returned
+	typedef std::vector<std::shared_ptr<Frame_ring>> Ring_vec;
+	std::shared_ptr<Frame_ring> default_ring;//Ring used by get_images and get_frames
+	std::shared_ptr<const Ring_vec> rings;//Rings receiving the sets, read by the acquisition thread with std::atomic_load and replaced (copy on write) with std::atomic_store
+	std::mutex rings_mtx;//Mutex serializing the modifications of rings
 
-	Trigger_vcp trigger;//External trigger
+	mutable std::mutex trigger_mtx;//Mutex for the custom_trigger, vcp_trigger and running_trigger variables
+	std::shared_ptr<Trigger> custom_trigger;//Trigger given by the user, nullptr if the serial trigger is used
+	std::shared_ptr<Trigger_vcp> vcp_trigger;//Serial trigger, created at the first start needing it and kept open until its configuration changes
+	std::shared_ptr<Trigger> running_trigger;//Trigger of the current acquisition, only used by the acquisition thread once it is started
 	std::mutex trigger_port_name_mtx; //Mutex for the trigger_port_name variable
     std::string trigger_port_name;//Portname to use to launch the trigger
     #ifdef __unix__
     std::atomic<speed_t> trigger_baudrate;//Baudrate to use to launch the trigger
     #endif
+    std::atomic<uint32_t> trigger_period_us;//Period of the free running trigger, 0 if a trigger is sent for each set
+
+    std::atomic<bool> parallel_retrieval;//True if the images are retrieved by one thread per camera
+    std::atomic<int64_t> sync_tolerance_us;//Tolerance of the synchronizer, 0 if it is not used
+    std::atomic<Straggler_policy> sync_policy;
+    std::atomic<uint64_t> sync_dropped_frames;
+
+    std::mutex thread_policy_mtx;//Mutex for the thread_policy variable
+    Thread_policy thread_policy;//Scheduling of the threads, applied at the start of the acquisition
+
+    std::mutex param_queue_mtx;//Mutex for the param_queue, param_posted and param_applied variables
+    std::condition_variable param_queue_cv;//Notified when commands have been applied
+    std::vector<Param_command> param_queue;//Commands waiting for the acquisition thread
+    uint64_t param_posted;//Number of commands posted since the creation
+    uint64_t param_applied;//Number of commands applied since the creation
+
+    Latency_stats latency;//Lock free, written by the acquisition thread and by get_frames
+    std::atomic<int> latency_report_period_ms;
 
     clock_type::time_point origin_tp; // used as origin for image timestamps. Initialized with the clock epoch, can be specified in the constructor.
     clock_type::time_point current_tp; // used as origin for image timestamps. Initialized with the clock epoch, can be specified in the constructor.
-    int64_t timestamp; // time since origin_tp, expressed in microseconds. This is updated after each successful acquisition. Note this variable is protected by the mutex images_ready_mtx
 
 	void thread_func();//Acquisition function launched by the acquisition thread
+	//Get an image from each camera, camera_vec_mtx has to be locked. results holds the value returned for each camera, the function returns true if all the images are valid.
+	//trigger_tp is the end of the trigger preceding the retrieval (not set if there is none), the stages of the valid images are recorded in the latency statistics.
+	//trigger_seq is the sequence id of this trigger (negative if there is none), its acknowledgement gives the device time of the pulse to the images.
+	//With the free running trigger, free_running is true and each image gets the latest pulse acknowledged before its arrival instead.
+	bool retrieve_set(std::vector<cv::Mat>& images, std::vector<Frame_info>& info, std::vector<int>& results, std::vector<std::unique_ptr<Retrieval_worker>>& workers, const clock_type::time_point& trigger_tp, int trigger_seq, bool free_running);
+	void publish(const std::shared_ptr<Frame_set>& frame_set);//Give a set to every ring
+	void clear_rings();//Empty every ring
 	void close_cameras();//Close each camera
+	//Apply the waiting commands, camera_vec_mtx has to be locked. If cameras_started is true and a command is not live, the cameras are stopped and started again.
+	void apply_param_commands(bool cameras_started, bool only_one_camera);
+	void reset_vcp_trigger();//Close the serial trigger, the acquisition has to be stopped
 
 }; //class Acquisition
 
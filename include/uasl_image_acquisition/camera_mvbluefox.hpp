@@ -56,7 +56,9 @@ class BlueFoxParameters : public Camera_params
 		p_dev = p_dev_;
 	}
 	
-	//Please note that the following set functions stop the acquisition
+	//Please note that the following set functions do not wait : the modifications are applied by the acquisition thread between two frames (see Camera_params::post_command),
+	//use Acquisition::wait_param_commands to wait for them. The exposure, the gain, the automatic controls and the timeout are modified without interrupting the stream,
+	//the other parameters posted together are applied with a single stop and start of the camera.
     void set_image_size(int width, int height);
     void set_image_roi(int startx, int starty, int width, int height);
     void set_agc(bool value);
@@ -65,17 +67,33 @@ class BlueFoxParameters : public Camera_params
     void set_trigger_mode(mvIMPACT::acquire::TCameraTriggerMode trigger_mode);
     void set_trigger_source(mvIMPACT::acquire::TCameraTriggerSource trigger_source);
     void set_exposure_time(int exposure_time_us);//The exposure time is in microseconds
+    void set_gain(double gain_db);//Ignored by the camera if the automatic gain control is on
     void set_pixelclock(mvIMPACT::acquire::TCameraPixelClock pixelclock);
     void set_request_timeout_ms(int timeout_ms);
     
     int get_pixel_format() const
     {
-    	return pixel_format;
+    	return pixel_format.load();
     }
     
     private:
+    friend class CamBlueFox;//Applies the default settings when the camera is opened
+
     mvIMPACT::acquire::Device * p_dev;
-    int pixel_format;//Pixel format for the output image
+    std::atomic<int> pixel_format;//Pixel format for the output image, modified by the acquisition thread
+
+    //Functions applying the modifications, called by the acquisition thread (or directly if the acquisition is stopped)
+    void apply_image_size(int width, int height);
+    void apply_image_roi(int startx, int starty, int width, int height);
+    void apply_agc(bool value);
+    void apply_aec(bool value);
+    void apply_image_type(int ocv_color_code);
+    void apply_trigger_mode(mvIMPACT::acquire::TCameraTriggerMode trigger_mode);
+    void apply_trigger_source(mvIMPACT::acquire::TCameraTriggerSource trigger_source);
+    void apply_exposure_time(int exposure_time_us);
+    void apply_gain(double gain_db);
+    void apply_pixelclock(mvIMPACT::acquire::TCameraPixelClock pixelclock);
+    void apply_request_timeout_ms(int timeout_ms);
     
     bool check_cam() const
     {
@@ -97,10 +115,12 @@ class CamBlueFox : public Camera_seq
     int start_acq(bool only_one_camera) override;
     int stop_acq() override;
     int retrieve_image(cv::Mat& image) override;
+    int retrieve_frame(cv::Mat& image, Frame_info& info) override;//The device timestamp is the timestamp of the request given by the driver
+    int set_thread_policy(const Thread_policy& policy) override;//The driver threads can not be pinned, only the priority of its worker thread is raised
     
     virtual BlueFoxParameters& get_params() override
     {    	
-    	//Note that the acquisition has to be stopped by the caller
+    	//The acquisition does not have to be stopped, the set functions post their modifications (see Camera_params::post_command)
     	return params;
     }
     
@@ -123,9 +143,12 @@ class CamBlueFox : public Camera_seq
     
     void export_image(int width, int height, void * vpData, int pixel_format, cv::Mat& image)
     {
-        //Copy the image from the internal buffer of the camera to currentImage.
+        //Copy the image from the internal buffer of the camera to the buffer of the set given by the frame pool (no allocation once the pool is warm).
+        //This is the only copy of the BlueFox path, and it is kept on purpose : the request buffer belongs to the driver and is reused as soon as the
+        //request is unlocked. Wrapping it would require keeping the request locked until the consumer releases the set, and the driver only has a few
+        //requests, so a consumer holding sets (rings, recorder) would stall the camera. cv::Mat also has no way to unlock the request when it is released.
         cv::Mat temp_img(height, width, pixel_format, vpData);
-        temp_img.copyTo(image);//We construct a temporary header to avoid memory alignment issue (useful compared to a memcpy ?)
+        temp_img.copyTo(image);//Temporary header on the driver buffer, copyTo reuses the buffer of image if the format did not change
     }
     
     void print_all_request_state();//For debugging purposes, print the state of all request objects
@@ -0,0 +1,118 @@
+#ifndef UASL_IMAGE_ACQUISITION_CAMERA_REPLAY_HPP
+#define UASL_IMAGE_ACQUISITION_CAMERA_REPLAY_HPP
+
+#include "camera_sequential.hpp"
+#include "cond_var_package.hpp"
+#include "recording_reader.hpp"
+#include "util_clock.hpp"
+
+#include "opencv2/core/version.hpp"
+#if CV_MAJOR_VERSION == 2
+#include <opencv2/core/core.hpp>
+#elif CV_MAJOR_VERSION == 3
+#include <opencv2/core.hpp>
+#endif
+
+#include <memory> //For unique_ptr
+#include <string>
+#include <vector>
+
+namespace cam
+{
+
+enum Replay_pacing {realtime, as_fast_as_possible, fixed_rate};//realtime follows the recorded timestamps
+
+static constexpr Replay_pacing replay_pacing_d = realtime;//Default pacing
+static constexpr double replay_rate_hz_d = 30.0;//Default rate for fixed_rate (also used in realtime if the session has no timestamps)
+static constexpr int replay_end_wait_ms = 100;//Wait before returning an error at the end of the session, so the acquisition does not spin
+
+class ReplayParameters : public Camera_params
+{
+	public:
+	ReplayParameters(Cond_var_package& package_) :	Camera_params(package_),
+													camera_index(0),
+													pacing(replay_pacing_d),
+													rate_hz(replay_rate_hz_d),
+													loop(false),
+													preload(false)
+													{}
+
+	//Please note that the following set functions do not wait : the modifications are applied by the acquisition thread between two frames (see Camera_params::post_command),
+	//use Acquisition::wait_param_commands to wait for them. The replay camera is stopped and started again around them : its session is reloaded and played from the first image.
+	void set_camera_index(int camera_index);//Index of the recorded camera to play (cam{index}_image*.png, or image index in a recording)
+	void set_pacing(Replay_pacing pacing, double rate_hz = replay_rate_hz_d);//rate_hz is only used with fixed_rate
+	void set_loop(bool loop);//Restart from the first image at the end of the session
+	void set_preload(bool preload);//Decode all the images at start, so that the replay measures the acquisition alone and not the decoding
+
+	int get_camera_index() const { return camera_index; }
+	Replay_pacing get_pacing() const { return pacing; }
+	double get_rate_hz() const { return rate_hz; }
+	bool get_loop() const { return loop; }
+	bool get_preload() const { return preload; }
+
+	private:
+	int camera_index;
+	Replay_pacing pacing;
+	double rate_hz;
+	bool loop;
+	bool preload;
+}; //class ReplayParameters
+
+class CamReplay : public Camera_seq
+{
+	//Play back a recorded session as if it was a camera. The session is either:
+	//-a directory with the layout written by stereo_example (cam{i}_image%05d.png and image_data.csv with "number,timestamp" lines),
+	//-a recording written by the Recorder (see recording_reader.hpp).
+	//The device timestamp of the images is the recorded timestamp. The camera does not need the external trigger.
+	//At the end of the session (without loop), retrieve_image returns -3.
+	public:
+	CamReplay(Cond_var_package& package_, const std::string& session_path);
+	virtual ~CamReplay();
+
+	int start_acq(bool only_one_camera) override;
+	int stop_acq() override;
+	int retrieve_image(cv::Mat& image) override;
+	int retrieve_frame(cv::Mat& image, Frame_info& info) override;
+	bool needs_external_trigger() const override { return false; }
+
+	virtual ReplayParameters& get_params() override
+	{
+		//The acquisition does not have to be stopped, the set functions post their modifications (see Camera_params::post_command)
+		return params;
+	}
+
+	size_t get_frame_count() const { return frame_count(); }//Number of images of the session (after start_acq)
+
+	private:
+	struct Png_frame
+	{
+		std::string file_name;
+		int64_t timestamp;//Recorded timestamp in microseconds, -1 if unknown
+	};
+
+	ReplayParameters params;//Interface to modify the parameters of the replay
+	std::string session_path;
+
+	std::vector<Png_frame> png_frames;//Directory layout
+	std::vector<cv::Mat> preloaded;//Decoded images if preload is set
+	std::unique_ptr<Recording_reader> reader;//Recording layout
+	Frame_set recorded_set;//Views on the current set of the recording
+
+	size_t next_frame;//Index of the next image to give
+	clock_type::time_point start_tp;//Time at which the replay of the first image started
+	int64_t first_timestamp;
+	bool opened;
+
+	int load_session();
+	size_t frame_count() const;
+	int64_t frame_timestamp(size_t n) const;
+	int read_frame(size_t n, cv::Mat& image);//Give the image number n (decoded, copied from the preloaded images or from the recording)
+	void wait_for_frame(size_t n);//Sleep until the time of the image number n, according to the pacing
+}; //class CamReplay
+
+template<>
+std::unique_ptr<Camera_seq> Camera_seq::get_instance<replay>(Cond_var_package& package, const std::string& session_path);
+
+} //namespace cam
+
+#endif
@@ -2,8 +2,12 @@
 #define UASL_IMAGE_ACQUISITION_CAMERA_SEQUENTIAL_HPP
 
 #include "cond_var_package.hpp"
+#include "util_clock.hpp"
+#include "util_thread.hpp"
 #include <memory>
 #include <string>
+#include <cstdint>
+#include <functional>
 
 #include "opencv2/core/version.hpp"
 #if CV_MAJOR_VERSION == 2
@@ -15,7 +19,32 @@
 namespace cam
 {
 
-enum CameraType {bluefox,tau2};
+enum CameraType {bluefox,tau2,replay,synthetic};
+
+struct Frame_info
+{
+	//Information about the acquisition of a single image
+	Frame_info() : device_timestamp_us(-1), trigger_device_us(-1) {}
+	int64_t device_timestamp_us;//Timestamp given by the camera itself in microseconds (the origin depends on the camera). Negative if not available.
+	int64_t trigger_device_us;//Time of the trigger pulse given by the clock of the trigger device in microseconds (see Trigger_ack). Negative if not triggered or not acknowledged.
+	clock_type::time_point host_tp;//Time at which the image has been received by the host
+
+	//Timestamps of the stages of the pipeline, for the latency statistics (see Latency_stats). Not set (clock epoch) if not available.
+	clock_type::time_point trigger_tp;//End of the trigger preceding the retrieval, or time of the pulse with a free running trigger (see Trigger_ack::pulse_tp), set by the acquisition
+	clock_type::time_point usb_tp;//Arrival of the first USB payload of the image, set by the camera
+	clock_type::time_point decoded_tp;//End of the decoding of the image by the driver, set by the camera
+	clock_type::time_point retrieved_tp;//Return of retrieve_frame, set by the acquisition
+};
+
+class Camera_params;
+
+struct Param_command
+{
+	//Modification of a parameter, applied by the acquisition thread between two frames (see Camera_params::post_command)
+	std::function<void()> apply;
+	bool live;//True if the parameter can be modified while the camera streams, else the camera is stopped and started again around it
+	const Camera_params* params;//Parameters which posted the command : only their camera is stopped and started again
+};
 
 class Camera_params
 {
@@ -25,6 +54,12 @@ class Camera_params
 	
 	protected:
 	Cond_var_package& package;
+
+	//Give a modification to the acquisition without waiting : it is applied immediately if the acquisition is stopped, else by the acquisition thread
+	//before the next frame. The commands posted together are applied in order, with a single stop and start of each camera having a command which is not live.
+	//This is an alternative to Acquisition_lock, which stops the acquisition for each modification. The command must not lock the acquisition.
+	//Please note that it must not be called from the constructor of a camera : Acquisition::add_camera holds the camera vector while the camera is created.
+	void post_command(const std::function<void()>& apply, bool live);
 };
 
 //Note : if your camera has parameters, you should pass a Cond_var_package& to this struct, this can be done by passing it to the constructor of Camera_seq
@@ -33,9 +68,19 @@ class Camera_seq
 	public:
     virtual ~Camera_seq() {}
     virtual int retrieve_image(cv::Mat& img) = 0;
+    virtual int retrieve_frame(cv::Mat& img, Frame_info& info)
+    {
+    	//Same as retrieve_image, and give information about the image. Override this function if the camera provides its own timestamps.
+    	const int ret = retrieve_image(img);
+    	info.device_timestamp_us = -1;
+    	info.host_tp = clock_type::now();
+    	return ret;
+    }
 	virtual int start_acq(bool only_one_camera) = 0;
     virtual int stop_acq() = 0;    
     virtual Camera_params& get_params() = 0; 
+    virtual bool needs_external_trigger() const { return true; }//False if the camera does not use the external trigger (e.g. replay), the trigger is only opened if a camera needs it
+    virtual int set_thread_policy(const Thread_policy& /*policy*/) { return 0; }//Apply the policy to the threads of the driver (USB events, decoding), if the camera has any. Returns 0 on success.
     
     template <CameraType T> 
     static std::unique_ptr<Camera_seq> get_instance(Cond_var_package& package, const std::string& cam_id)
@@ -0,0 +1,138 @@
+#ifndef UASL_IMAGE_ACQUISITION_CAMERA_SYNTHETIC_HPP
+#define UASL_IMAGE_ACQUISITION_CAMERA_SYNTHETIC_HPP
+
+#include "camera_sequential.hpp"
+#include "cond_var_package.hpp"
+#include "trigger_loopback.hpp"
+#include "util_clock.hpp"
+
+#include "opencv2/core/version.hpp"
+#if CV_MAJOR_VERSION == 2
+#include <opencv2/core/core.hpp>
+#elif CV_MAJOR_VERSION == 3
+#include <opencv2/core.hpp>
+#endif
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+
+namespace cam
+{
+
+enum Latency_distribution {latency_constant, latency_uniform, latency_normal};
+
+static constexpr int synthetic_width_d = 640;//Default width
+static constexpr int synthetic_height_d = 480;//Default height
+static constexpr int synthetic_type_d = CV_8UC1;//Default pixel type
+static constexpr double synthetic_rate_hz_d = 30.0;//Default frame rate
+static constexpr int64_t synthetic_latency_us_d = 2000;//Default time between the exposure and the reception of an image
+static constexpr int synthetic_timeout_ms = 500;//Time spent in retrieve_image before reporting a timeout
+
+class SyntheticParameters : public Camera_params
+{
+	public:
+	SyntheticParameters(Cond_var_package& package_, uint64_t seed_) :	Camera_params(package_),
+																	width(synthetic_width_d),
+																	height(synthetic_height_d),
+																	type(synthetic_type_d),
+																	rate_hz(synthetic_rate_hz_d),
+																	latency_us(synthetic_latency_us_d),
+																	jitter_us(0),
+																	distribution(latency_constant),
+																	drop_probability(0),
+																	timeout_probability(0),
+																	clock_offset_us(0),
+																	seed(seed_)
+																	{}
+
+	//Please note that the following set functions do not wait : the modifications are applied by the acquisition thread between two frames (see Camera_params::post_command),
+	//use Acquisition::wait_param_commands to wait for them. The rate, the seed and the trigger restart the camera, the generator restarts from the seed at each start.
+	void set_image_format(int width, int height, int type);
+	void set_rate(double rate_hz);
+	void set_latency(int64_t latency_us, int64_t jitter_us = 0, Latency_distribution distribution = latency_constant);//jitter is the half width (uniform) or the standard deviation (normal)
+	void set_drop_probability(double probability);//Probability that a frame is lost : the next one is given instead
+	void set_timeout_probability(double probability);//Probability that a retrieval times out
+	void set_clock_offset_us(int64_t offset_us);//Origin of the device timestamps
+	void set_seed(uint64_t seed);
+	//Expose the images on the pulses of an in-process trigger instead of the rate, when the camera is used with other ones.
+	//Give the same trigger to the acquisition (Acquisition::set_trigger) and to every synthetic camera. nullptr (default) goes back to the free run.
+	void set_trigger(const std::shared_ptr<Trigger_loopback>& trigger);
+
+	int get_width() const { return width; }
+	int get_height() const { return height; }
+	int get_type() const { return type; }
+	double get_rate_hz() const { return rate_hz; }
+	int64_t get_latency_us() const { return latency_us; }
+	int64_t get_jitter_us() const { return jitter_us; }
+	Latency_distribution get_distribution() const { return distribution; }
+	double get_drop_probability() const { return drop_probability; }
+	double get_timeout_probability() const { return timeout_probability; }
+	int64_t get_clock_offset_us() const { return clock_offset_us; }
+	uint64_t get_seed() const { return seed; }
+	std::shared_ptr<Trigger_loopback> get_trigger() const { return trigger; }
+
+	private:
+	int width;
+	int height;
+	int type;//OpenCV type of the images
+	double rate_hz;
+	int64_t latency_us;
+	int64_t jitter_us;
+	Latency_distribution distribution;
+	double drop_probability;
+	double timeout_probability;
+	int64_t clock_offset_us;
+	uint64_t seed;
+	std::shared_ptr<Trigger_loopback> trigger;
+}; //class SyntheticParameters
+
+class CamSynthetic : public Camera_seq
+{
+	//Free running camera generating images at a given rate, without any hardware.
+	//The frame k is exposed at start + k / rate and received after a random latency. If the caller is late by more
+	//than one period, the frames in between are lost (as with a real camera with a short queue), which appears as
+	//a gap in the device timestamps. The first bytes of each row hold the frame number, so a consumer can check the data.
+	//All the randomness comes from the seed (by default the hash of the camera id), so a run can be reproduced.
+	//With a loopback trigger (SyntheticParameters::set_trigger) and several cameras, the frame k is exposed at the pulse k instead.
+	public:
+	CamSynthetic(Cond_var_package& package_, const std::string& cam_id);
+	virtual ~CamSynthetic() {}
+
+	int start_acq(bool only_one_camera) override;
+	int stop_acq() override;
+	int retrieve_image(cv::Mat& image) override;
+	int retrieve_frame(cv::Mat& image, Frame_info& info) override;
+	bool needs_external_trigger() const override { return params.get_trigger() != nullptr; }
+
+	virtual SyntheticParameters& get_params() override
+	{
+		//The acquisition does not have to be stopped, the set functions post their modifications (see Camera_params::post_command)
+		return params;
+	}
+
+	uint64_t get_lost_frames() const { return lost_frames; }//Frames dropped or skipped since the start
+
+	private:
+	SyntheticParameters params;//Interface to modify the parameters of the camera
+
+	std::mt19937_64 generator;
+	clock_type::time_point start_tp;
+	int64_t period_us;
+	uint64_t next_frame;//Number of the next frame to give
+	uint64_t lost_frames;
+	std::shared_ptr<Trigger_loopback> trigger;//Trigger of the current acquisition, nullptr in free run
+	uint64_t last_pulse;//Number of the last pulse of the trigger used
+
+	int retrieve_triggered_frame(cv::Mat& image, Frame_info& info);
+	int64_t draw_latency_us();
+	void fill_image(cv::Mat& image, uint64_t frame_nb) const;
+}; //class CamSynthetic
+
+template<>
+std::unique_ptr<Camera_seq> Camera_seq::get_instance<synthetic>(Cond_var_package& package, const std::string& cam_id);
+
+} //namespace cam
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "camera_sequential.hpp"
 #include "cond_var_package.hpp"
+#include "tone_mapper.hpp"
 #include "util_clock.hpp"
 
 #include "opencv2/core/version.hpp"
@@ -34,14 +35,23 @@ class Tau2Parameters : public Camera_params
 {
 	public:
 	Tau2Parameters(Cond_var_package& package_) :    Camera_params(package_),
+                                                    p_grab(nullptr),
                                                     image_ROI(startx_dt,starty_dt,width_dt,height_dt),
-													pixel_format(pixel_format_dt)
+													pixel_format(pixel_format_dt),
+													use_pps_timestamp(false),
+													trigger_mode(thermal_grabber::TriggerMode::disabled),
+													tone_mapping(tone_linear),
+													plateau(tone_plateau_d)
 													{}
 
-	//Please note that the following set functions stop the acquisition
-    void set_image_roi(int startx, int starty, int width, int height);
-    void set_pixel_format(int pixel_format);
+	//Please note that the following set functions do not wait : the modifications are applied by the acquisition thread between two frames (see Camera_params::post_command),
+	//use Acquisition::wait_param_commands to wait for them. All of them are modified without interrupting the stream
+	//(a restart of the Tau2 would run a flat field correction).
+    void set_image_roi(int startx, int starty, int width, int height);//Cropped by the driver while decoding, limited to the sensor size
+    void set_pixel_format(int pixel_format);//CV_16U (raw values) or CV_8U (converted with the tone mapping)
+    void set_tone_mapping(Tone_mapping tone_mapping, double plateau = tone_plateau_d);//Conversion to 8 bits, see Tone_mapper (the plateau is only used by tone_plateau)
     void set_trigger_mode(thermal_grabber::TriggerMode trigger_mode);
+    void set_use_pps_timestamp(bool use_pps);//Use the PPS counter of the grabber as device timestamp (only meaningful if a PPS signal is connected). The seconds are counted with the host clock, see callbackTauImage
 
     void setThermalGrabber(ThermalGrabber* p_grab_){
         p_grab = p_grab_;
@@ -56,10 +66,30 @@ class Tau2Parameters : public Camera_params
         return image_ROI;
     }
 
+    bool get_use_pps_timestamp() const{
+        return use_pps_timestamp.load();
+    }
+
+    thermal_grabber::TriggerMode get_trigger_mode() const{
+        return trigger_mode;
+    }
+
+    Tone_mapping get_tone_mapping() const{
+        return tone_mapping;
+    }
+
+    double get_plateau() const{
+        return plateau;
+    }
+
     private:
     ThermalGrabber* p_grab; //thermal grabber
     cv::Rect image_ROI;
     int pixel_format;//Pixel format for the output image
+    std::atomic<bool> use_pps_timestamp;//Read by the USB callback thread
+    thermal_grabber::TriggerMode trigger_mode;//Applied by start_acq
+    Tone_mapping tone_mapping;
+    double plateau;
 
 }; //class Tau2Parameters
 
@@ -72,10 +102,12 @@ class CamTau2 : public Camera_seq
     int start_acq(bool only_one_camera) override;
     int stop_acq() override;
     int retrieve_image(cv::Mat& image) override;
+    int retrieve_frame(cv::Mat& image, Frame_info& info) override;
+    int set_thread_policy(const Thread_policy& policy) override;//Applied to the USB and decoder threads of libthermalgrabber
 
     virtual Tau2Parameters& get_params() override
     {
-    	//Note that the acquisition has to be stopped by the caller
+    	//The acquisition does not have to be stopped, the set functions post their modifications (see Camera_params::post_command)
     	return params;
     }
 
@@ -88,6 +120,13 @@ class CamTau2 : public Camera_seq
     std::condition_variable cv;
     std::mutex image_available_mutex;
     cv::Mat image_acquired;
+    cv::Mat image_decoded;//Buffer written by the callback, exchanged with image_acquired (only used by the callback)
+    cv::Mat image_raw;//16 bits image being converted to 8 bits, exchanged with image_acquired (only used by retrieve_frame)
+    Tone_mapper tone_mapper;//Conversion to 8 bits, done when the image is retrieved (only used by retrieve_frame)
+    Frame_info info_acquired;//Timestamps of image_acquired
+    int64_t pps_base_us;//Device time of the last PPS edge, incremented by the seconds elapsed between two frames (only used by the callback)
+    unsigned int last_pps;
+    clock_type::time_point last_pps_tp;//Host time of arrival of the frame giving last_pps, epoch if none yet (only used by the callback)
     bool opened;//True if the camera has been successfully opened (different from mvIMPACT::acquire::Device::isOpen)
 
     void init(const std::string& cam_id);//Initialisation function for the camera
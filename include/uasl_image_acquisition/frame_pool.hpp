@@ -0,0 +1,68 @@
+#ifndef UASL_IMAGE_ACQUISITION_FRAME_POOL_HPP
+#define UASL_IMAGE_ACQUISITION_FRAME_POOL_HPP
+
+#include "camera_sequential.hpp"
+
+#include "opencv2/core/version.hpp"
+#if CV_MAJOR_VERSION == 2
+#include <opencv2/core/core.hpp>
+#elif CV_MAJOR_VERSION == 3
+#include <opencv2/core.hpp>
+#endif
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace cam {
+
+struct Frame_set
+{
+	std::vector<cv::Mat> images;//One image per camera, in the order the cameras have been added. An image can be empty if the set has been padded (see Frame_synchronizer)
+	std::vector<Frame_info> frame_info;//Information about each image
+	int64_t timestamp;//Time since the origin of the acquisition, expressed in microseconds
+	uint64_t seq;//Sequence number of the set, incremented for each set published by the acquisition. A gap means sets have been lost.
+	clock_type::time_point published_tp;//Time at which the set has been given to the rings
+};
+
+//Handle given to the consumers. The images are shared with the acquisition and must not be modified.
+//The buffers go back to the pool once the last handle is released, so clone an image if you need it for longer.
+typedef std::shared_ptr<const Frame_set> Frame_set_ptr;
+
+class Frame_pool
+{
+	//The goal of this class is to avoid allocating and copying the images for each set:
+	//the acquisition fills a set taken from the pool, the consumers share it through Frame_set_ptr, and the
+	//set (with its image buffers) is given back to the pool when the last reference disappears.
+	public:
+	Frame_pool();
+
+	std::shared_ptr<Frame_set> acquire(size_t cam_number);//Get a set able to hold cam_number images, recycled if possible
+
+	size_t allocated() const;//Number of sets allocated by the pool so far (for debugging purposes)
+
+	private:
+	struct Pool_state
+	{
+		Pool_state() : allocated(0) {}
+		std::mutex mtx;//Mutex protecting the free list
+		std::vector<std::unique_ptr<Frame_set>> free_sets;//Sets ready to be reused
+		size_t allocated;
+	};
+
+	struct Recycler
+	{
+		//Deleter of the shared pointers : give the set back to the pool, or delete it if the pool does not exist anymore
+		std::weak_ptr<Pool_state> state;
+		void operator()(Frame_set * set) const;
+	};
+
+	std::shared_ptr<Pool_state> state;
+
+	static bool is_shared(const cv::Mat& img);//True if the buffer of the image is still referenced elsewhere
+}; //class Frame_pool
+
+} //namespace cam
+
+#endif
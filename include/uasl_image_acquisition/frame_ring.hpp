@@ -0,0 +1,67 @@
+#ifndef UASL_IMAGE_ACQUISITION_FRAME_RING_HPP
+#define UASL_IMAGE_ACQUISITION_FRAME_RING_HPP
+
+#include "frame_pool.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+namespace cam {
+
+enum Overflow_policy {overwrite_oldest, block_producer};//Behaviour of a ring when the producer finds it full
+
+class Frame_ring
+{
+	//Ring of sets of images with a single producer (the acquisition thread) and one or several consumers.
+	//The slots are exchanged with the atomic shared_ptr functions and the positions are atomic counters, so the producer and
+	//the consumers never wait for each other during the hand-off. Please note that this is not lock-free : the standard library
+	//may implement the atomic shared_ptr functions with a pool of mutexes held for the copy of one pointer.
+	//wait_mtx and the condition variables are only used to put a thread to sleep when the ring is empty (consumers) or full
+	//with the block_producer policy (producer), and they are only touched by the other side if somebody is actually sleeping.
+	//A slot is emptied when its set is popped, so the sets consumed go back to the pool as soon as the consumer releases them.
+	public:
+	Frame_ring(size_t depth, Overflow_policy policy);
+
+	//Producer side. Returns false if the set has been dropped (block_producer policy, the ring stayed full for timeout_ms)
+	bool push(const Frame_set_ptr& frame_set, int timeout_ms);
+
+	//Consumer side. Returns false if no set was available before timeout_ms.
+	bool pop(Frame_set_ptr& frame_set, int timeout_ms);
+	bool try_pop(Frame_set_ptr& frame_set);
+
+	void clear();//Remove all the waiting sets (consumer side)
+
+	size_t size() const;//Number of sets waiting in the ring
+	size_t depth() const { return slots.size(); }
+	Overflow_policy policy() const { return overflow_policy; }
+
+	uint64_t pushed() const { return pushed_count.load(); }//Number of sets inserted in the ring
+	uint64_t dropped() const { return dropped_count.load(); }//Number of sets lost : overwritten, or refused with the block_producer policy
+
+	private:
+	std::vector<Frame_set_ptr> slots;//Only accessed through std::atomic_load / std::atomic_store
+	const Overflow_policy overflow_policy;
+
+	std::atomic<uint64_t> head;//Position of the next insertion (only modified by the producer)
+	std::atomic<uint64_t> tail;//Position of the oldest set (modified by the consumers, and by the producer when overwriting)
+
+	std::atomic<uint64_t> pushed_count;
+	std::atomic<uint64_t> dropped_count;
+
+	std::mutex wait_mtx;//Only used for sleeping
+	std::condition_variable data_cv;//Notified when a set is inserted and a consumer is sleeping
+	std::condition_variable space_cv;//Notified when a set is removed and the producer is sleeping
+	std::atomic<int> consumers_waiting;
+	std::atomic<bool> producer_waiting;
+
+	bool has_space() const { return head.load() - tail.load() < slots.size(); }
+	bool has_data() const { return tail.load() < head.load(); }
+}; //class Frame_ring
+
+} //namespace cam
+
+#endif
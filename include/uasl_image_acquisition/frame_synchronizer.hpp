@@ -0,0 +1,78 @@
+#ifndef UASL_IMAGE_ACQUISITION_FRAME_SYNCHRONIZER_HPP
+#define UASL_IMAGE_ACQUISITION_FRAME_SYNCHRONIZER_HPP
+
+#include "camera_sequential.hpp"
+#include "frame_pool.hpp"
+#include "util_clock.hpp"
+
+#include "opencv2/core/version.hpp"
+#if CV_MAJOR_VERSION == 2
+#include <opencv2/core/core.hpp>
+#elif CV_MAJOR_VERSION == 3
+#include <opencv2/core.hpp>
+#endif
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace cam {
+
+enum Straggler_policy {drop_incomplete, pad_incomplete};//What to do with a set when a camera has no image in the tolerance window
+
+static constexpr size_t sync_queue_depth = 8;//Maximum number of images waiting for each camera
+static constexpr size_t sync_offset_window = 64;//Number of images used to estimate the offset between the clock of a camera and the host clock
+
+class Frame_synchronizer
+{
+	//Assemble the images of the cameras into sets according to their timestamps instead of their order of arrival.
+	//Each image gets an aligned time on the host clock : if the camera gives its own timestamp, the offset between
+	//the camera clock and the host clock is estimated as the minimum of (arrival time - camera timestamp) over the
+	//last images (the minimum removes most of the transfer jitter), otherwise the arrival time is used directly.
+	//A set is made of the images whose aligned times are within the tolerance of the oldest waiting image. When a
+	//camera has no image in this window (it skipped a frame), the set is either dropped or padded with an empty image,
+	//so a lost frame only affects one set instead of shifting the camera for the rest of the acquisition.
+	//This class is not thread safe, it is used by the acquisition thread only.
+	public:
+	Frame_synchronizer(size_t cam_number, int64_t tolerance_us, Straggler_policy policy, int64_t max_wait_us);
+
+	//Give an image of the camera cam_idx. The image is swapped with a recycled buffer, so the caller can use it for the next retrieval.
+	void push(size_t cam_idx, cv::Mat& image, const Frame_info& info);
+
+	//Fill the set with the next complete (or padded) set if there is one. set_tp is the aligned time of the set.
+	bool pop_set(Frame_set& frame_set, clock_type::time_point& set_tp, const clock_type::time_point& now);
+
+	uint64_t get_dropped_frames() const { return dropped_frames; }//Images discarded (incomplete sets, or queue overflow)
+	uint64_t get_padded_sets() const { return padded_sets; }
+
+	private:
+	struct Entry
+	{
+		cv::Mat image;
+		Frame_info info;
+		clock_type::time_point aligned_tp;
+	};
+
+	struct Camera_queue
+	{
+		std::deque<Entry> entries;//Images waiting for a set, ordered by arrival
+		std::vector<cv::Mat> spare_images;//Buffers given back by the sets, reused for the next images
+		std::deque<int64_t> offsets_us;//Last values of (arrival time - camera timestamp)
+	};
+
+	const int64_t tolerance_us;
+	const Straggler_policy policy;
+	const int64_t max_wait_us;
+
+	std::vector<Camera_queue> queues;
+
+	uint64_t dropped_frames;
+	uint64_t padded_sets;
+
+	clock_type::time_point align(Camera_queue& queue, const Frame_info& info);//Compute the aligned time of an image
+	void discard_front(size_t cam_idx);
+}; //class Frame_synchronizer
+
+} //namespace cam
+
+#endif
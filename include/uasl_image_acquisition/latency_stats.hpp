@@ -0,0 +1,74 @@
+#ifndef UASL_IMAGE_ACQUISITION_LATENCY_STATS_HPP
+#define UASL_IMAGE_ACQUISITION_LATENCY_STATS_HPP
+
+#include "camera_sequential.hpp"
+#include "util_clock.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace cam {
+
+//Stages of the pipeline, each one is measured from the previous stage available for the image (see Latency_stats)
+enum Latency_stage {stage_trigger, stage_usb_arrival, stage_decoded, stage_retrieved, stage_published, stage_consumed, latency_stage_number};
+
+static constexpr int latency_bucket_number = 32;//Bucket k holds the durations in [2^(k-1), 2^k[ microseconds, bucket 0 the durations under 1 us
+
+struct Latency_summary
+{
+	Latency_summary() : count(0), mean_us(0), max_us(0), p50_us(0), p90_us(0), p99_us(0), buckets() {}
+	uint64_t count;//Number of durations recorded
+	double mean_us;
+	int64_t max_us;
+	int64_t p50_us;//Percentiles, given as the upper bound of the bucket holding them
+	int64_t p90_us;
+	int64_t p99_us;
+	uint64_t buckets[latency_bucket_number];
+};
+
+class Latency_histogram
+{
+	//Histogram of durations with logarithmic buckets. record is lock free (relaxed atomic operations) and can be called
+	//from any thread. The summary is computed from the current counters, it can miss the durations being recorded.
+	public:
+	Latency_histogram();
+
+	void record(int64_t duration_us);
+	Latency_summary summary() const;
+	void reset();
+
+	private:
+	std::atomic<uint64_t> buckets[latency_bucket_number];
+	std::atomic<uint64_t> sum_us;
+	std::atomic<int64_t> max_us;
+}; //class Latency_histogram
+
+class Latency_stats
+{
+	//Latency of each stage of the pipeline, measured with the host clock :
+	// - trigger : write of the trigger (Trigger_vcp::send_trigger)
+	// - usb_arrival : end of the trigger to the arrival of the first USB payload of the image
+	// - decoded : arrival of the image to the end of its decoding by the driver
+	// - retrieved : end of the decoding to the return of retrieve_frame
+	// - published : return of the last retrieve_frame of the set to the publication of the set in the rings
+	// - consumed : publication of the set to its pickup by get_frames/get_images
+	//When a camera does not provide a stage, the next stage is measured from the previous one available
+	//(e.g. retrieved from the trigger), and an image received before the trigger is not counted in the following stage.
+	public:
+	void record(Latency_stage stage, const clock_type::time_point& begin, const clock_type::time_point& end);//Ignored if begin is not set or is after end
+	void record_frame(const Frame_info& info);//Record the usb_arrival, decoded and retrieved stages of an image
+
+	Latency_summary summary(Latency_stage stage) const;
+	void reset();
+	void print(std::ostream& stream) const;//One line per stage
+
+	static const char* stage_name(Latency_stage stage);
+
+	private:
+	Latency_histogram histograms[latency_stage_number];
+}; //class Latency_stats
+
+} //namespace cam
+
+#endif
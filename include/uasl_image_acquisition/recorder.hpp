@@ -0,0 +1,76 @@
+#ifndef UASL_IMAGE_ACQUISITION_RECORDER_HPP
+#define UASL_IMAGE_ACQUISITION_RECORDER_HPP
+
+#include "frame_pool.hpp"
+#include "frame_ring.hpp"
+#include "recording_format.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+namespace cam {
+
+static constexpr size_t recorder_queue_depth_d = 32;//Default number of sets waiting to be written
+static constexpr size_t recorder_batch_size_d = 8 << 20;//Default size of the writes (8 MiB)
+static constexpr size_t recorder_block_size = 4096;//Alignment of the buffer and of the writes, required by O_DIRECT
+
+class Recorder
+{
+	//Write the sets to a raw binary file (see recording_format.hpp) from a dedicated thread.
+	//record() only queues a reference on the set, so the images are neither copied nor encoded by the caller.
+	//The writer thread copies the sets into a large aligned buffer, and writes it in one call when it is full :
+	//the throughput is then limited by the disk, not by the number of images. With direct_io, the file is opened
+	//with O_DIRECT to bypass the page cache (if the file system does not support it, a normal file is used).
+	//If the disk is too slow, the queue fills up and the new sets are dropped (see get_dropped_sets).
+	//An index of the records (see Index_entry) is written to file_name + rec::index_suffix, for the Recording_reader.
+	//Please note that the last batch is only written when the recorder is closed.
+	public:
+	Recorder(const std::string& file_name, bool direct_io = false, size_t queue_depth = recorder_queue_depth_d, size_t batch_size = recorder_batch_size_d);
+	~Recorder();//Write the remaining sets and close the file
+
+	bool is_open() const { return fd >= 0; }
+
+	bool record(const Frame_set_ptr& frame_set);//Queue a set, returns false if it has been dropped. The function does not block.
+
+	void close();//Write the remaining sets and close the file
+
+	uint64_t get_written_sets() const { return written_sets.load(); }
+	uint64_t get_dropped_sets() const { return queue.dropped(); }
+	uint64_t get_written_bytes() const { return written_bytes.load(); }//Size of the data written so far
+	bool has_error() const { return write_error.load(); }
+
+	private:
+	Frame_ring queue;//Sets waiting to be written
+
+	int fd;//File descriptor
+	bool direct_io;//True if the file has been opened with O_DIRECT
+	std::string file_name;
+	std::FILE * index_file;//Index of the records, small enough for buffered writes
+
+	unsigned char * buffer;//Staging buffer, aligned on recorder_block_size
+	size_t buffer_size;//Multiple of recorder_block_size
+	size_t buffer_fill;
+	uint64_t file_size;//Logical size of the file (bytes given to append)
+	std::vector<rec::Image_header> image_headers;//Headers of the current set, kept to avoid an allocation per set
+
+	std::thread writer_thd;
+	std::atomic<bool> should_run;
+	std::atomic<uint64_t> written_sets;
+	std::atomic<uint64_t> written_bytes;
+	std::atomic<bool> write_error;
+
+	void thread_func();
+	bool write_set(const Frame_set& frame_set);//Returns false if the set could not be written
+	void append(const void * data, size_t size);//Copy data to the buffer, write the buffer when it is full
+	void append_padding(size_t size);
+	void flush_buffer(size_t size);//Write the first size bytes of the buffer (size must be a multiple of the block size with O_DIRECT)
+	void finish();//Write the last partial batch (writer thread only)
+}; //class Recorder
+
+} //namespace cam
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef UASL_IMAGE_ACQUISITION_RECORDING_FORMAT_HPP
+#define UASL_IMAGE_ACQUISITION_RECORDING_FORMAT_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+namespace cam {
+
+//Layout of the recordings written by the Recorder.
+//The file starts with a File_header, followed by one record per set. Each record is made of a Record_header,
+//one Image_header per camera, then the raw data of the images (one row after the other, without padding between rows).
+//The headers and the data of each image start on a multiple of rec_alignment, so the size of a record is a
+//multiple of rec_alignment as well : the records can be walked with record_size alone, and an image can be used in place
+//from a mapped file. All the values are stored in the byte order of the host.
+namespace rec {
+
+static constexpr char file_magic[8] = {'U','A','S','L','R','E','C','1'};
+static constexpr uint32_t format_version = 2;//2 : index of the camera in the image headers
+static constexpr uint32_t record_magic = 0x53455453;//"SETS" in little endian
+static constexpr size_t rec_alignment = 64;//Alignment of the records and of the image data in the file
+
+struct File_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;//Offset of the first record
+	uint64_t reserved[6];
+};
+
+struct Record_header
+{
+	uint32_t magic;
+	uint32_t cam_number;
+	uint64_t seq;//Sequence number of the set
+	int64_t timestamp;//Timestamp of the set (microseconds since the origin of the acquisition)
+	uint64_t record_size;//Size of the whole record, headers and padding included
+};
+
+struct Image_header
+{
+	int32_t rows;
+	int32_t cols;
+	int32_t type;//OpenCV type of the image
+	int32_t cam_index;//Index of the camera in the acquisition (also the position of the header in the record)
+	uint64_t step;//Size of a row in bytes
+	uint64_t data_offset;//Offset of the data from the start of the record
+	uint64_t data_size;//0 if the image is empty (padded set)
+	int64_t device_timestamp_us;//-1 if the camera does not provide it
+	int64_t host_timestamp_us;//Arrival time on the host (time since the epoch of clock_type)
+	uint64_t reserved2;
+};
+
+static_assert(sizeof(File_header) == rec_alignment, "Unexpected size of the file header");
+static_assert(sizeof(Record_header) == 32, "Unexpected size of the record header");
+static_assert(sizeof(Image_header) == rec_alignment, "Unexpected size of the image header");
+
+//Index written next to the recording (file name + index_suffix) : an Index_header followed by one Index_entry per record.
+//The entries have a fixed size, so the index can be mapped and accessed directly by set number.
+static constexpr char index_magic[8] = {'U','A','S','L','I','D','X','1'};
+static constexpr const char * index_suffix = ".idx";
+
+struct Index_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t entry_size;
+	uint64_t reserved[6];
+};
+
+struct Index_entry
+{
+	uint64_t offset;//Offset of the record in the recording
+	int64_t timestamp;//Timestamp of the set
+	uint64_t seq;//Sequence number of the set
+	uint32_t cam_number;
+	uint32_t cam_mask;//Bit i is set if the image of the camera i is not empty
+};
+
+static_assert(sizeof(Index_header) == rec_alignment, "Unexpected size of the index header");
+static_assert(sizeof(Index_entry) == 32, "Unexpected size of an index entry");
+
+inline uint64_t align_size(uint64_t size)
+{
+	return (size + rec_alignment - 1) / rec_alignment * rec_alignment;
+}
+
+} //namespace rec
+
+} //namespace cam
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef UASL_IMAGE_ACQUISITION_RECORDING_READER_HPP
+#define UASL_IMAGE_ACQUISITION_RECORDING_READER_HPP
+
+#include "frame_pool.hpp"
+#include "recording_format.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cam {
+
+class Recording_reader
+{
+	//Random access to a recording written by the Recorder.
+	//The recording and its index are mapped in memory : going to a set is a lookup in the index, and the images
+	//given by read() are headers on the mapped data, nothing is decoded or copied. The pages are only loaded by the
+	//system when the images are used. If the index is missing or damaged, it is rebuilt by walking the records.
+	//Please note that the images point to read-only memory : clone them to modify them, or to use them after
+	//the destruction of the reader.
+	public:
+	Recording_reader(const std::string& file_name);
+	~Recording_reader();
+
+	Recording_reader(const Recording_reader&) = delete;
+	Recording_reader& operator=(const Recording_reader&) = delete;
+
+	bool is_open() const { return data != nullptr; }
+
+	size_t size() const { return entry_count; }//Number of sets in the recording
+
+	//Fill the set with the set number n. Returns 0 on success, -1 if n is out of range, -2 if the record is damaged.
+	int read(size_t n, Frame_set& frame_set) const;
+
+	int64_t get_timestamp(size_t n) const;//Timestamp of the set number n (-1 if out of range)
+	uint64_t get_seq(size_t n) const;
+	uint32_t get_cam_mask(size_t n) const;//Cameras with an image in the set number n (bit i for camera i)
+
+	size_t find(int64_t timestamp) const;//Number of the first set with a timestamp greater than or equal to timestamp (size() if none)
+
+	private:
+	const unsigned char * data;//Mapped recording
+	size_t data_size;
+	const unsigned char * index_data;//Mapped index, null if the index has been rebuilt
+	size_t index_size;
+
+	const rec::Index_entry * entries;//Points to the mapped index or to rebuilt_index
+	size_t entry_count;
+	std::vector<rec::Index_entry> rebuilt_index;
+
+	static const unsigned char * map_file(const std::string& file_name, size_t& size);
+	bool load_index(const std::string& index_name);
+	void rebuild_index();
+}; //class Recording_reader
+
+} //namespace cam
+
+#endif
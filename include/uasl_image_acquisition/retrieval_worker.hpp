@@ -0,0 +1,52 @@
+#ifndef UASL_IMAGE_ACQUISITION_RETRIEVAL_WORKER_HPP
+#define UASL_IMAGE_ACQUISITION_RETRIEVAL_WORKER_HPP
+
+#include "camera_sequential.hpp"
+#include "util_thread.hpp"
+
+#include "opencv2/core/version.hpp"
+#if CV_MAJOR_VERSION == 2
+#include <opencv2/core/core.hpp>
+#elif CV_MAJOR_VERSION == 3
+#include <opencv2/core.hpp>
+#endif
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace cam {
+
+class Retrieval_worker
+{
+	//Thread calling retrieve_frame on a single camera, so that the images of a set are retrieved in parallel.
+	//The acquisition thread posts a request for each camera, then waits for all of them : the time needed for a set
+	//is then the time of the slowest camera instead of the sum over all cameras.
+	//Please note that the worker does not lock anything on the camera, the caller must guarantee that the camera
+	//is not modified or destroyed while a request is running (the acquisition thread holds camera_vec_mtx for this purpose).
+	public:
+	Retrieval_worker(Camera_seq& camera_, const Thread_config& config_ = Thread_config());//The configuration is applied to the worker thread
+	~Retrieval_worker();
+
+	void post(cv::Mat& image, Frame_info& info);//Ask for an image, the function returns immediately
+	int wait();//Wait for the end of the posted request, and return the value of retrieve_frame
+
+	private:
+	Camera_seq& camera;
+	const Thread_config config;
+
+	std::thread worker_thd;
+	std::mutex mtx;//Mutex protecting the variables below
+	std::condition_variable request_cv;
+	cv::Mat * target;//Image to fill, non null if a request is pending
+	Frame_info * target_info;//Information to fill with the image
+	bool done;//True when the result of the last request is available
+	bool should_run;
+	int result;
+
+	void thread_func();
+}; //class Retrieval_worker
+
+} //namespace cam
+
+#endif
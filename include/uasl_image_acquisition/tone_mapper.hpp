@@ -0,0 +1,59 @@
+#ifndef UASL_IMAGE_ACQUISITION_TONE_MAPPER_HPP
+#define UASL_IMAGE_ACQUISITION_TONE_MAPPER_HPP
+
+#include "opencv2/core/version.hpp"
+#if CV_MAJOR_VERSION == 2
+#include <opencv2/core/core.hpp>
+#elif CV_MAJOR_VERSION == 3
+#include <opencv2/core.hpp>
+#endif
+
+#include <cstdint>
+#include <vector>
+
+namespace cam {
+
+enum Tone_mapping {tone_linear, tone_min_max, tone_histogram, tone_plateau};
+
+static constexpr double tone_linear_gain_d = 30.0/64.0;//Default gain of the linear mode (8 bits levels per raw count)
+static constexpr double tone_plateau_d = 0.01;//Default maximum height of a histogram bin in the plateau mode, as a fraction of the pixels
+
+class Tone_mapper
+{
+	//Conversion of thermal images (16 bits, usually 14 significant bits) to 8 bits.
+	//The statistics of the image are computed in one pass (SSE2/NEON), a look-up table covering the range of the image
+	//is built from them, and the table is applied in a second pass. The modes differ by the table :
+	// - linear : fixed gain, the mean of the image is mapped to 127 (conversion historically used by the Tau2 camera)
+	// - min_max : the range of the image is stretched over [0,255]
+	// - histogram : histogram equalization
+	// - plateau : histogram equalization with the bins limited to a plateau, so that large uniform areas (sky, ground)
+	//   do not take most of the output levels
+	//The buffers are kept between calls : converting images of the same size does not allocate. Not thread safe.
+	public:
+	Tone_mapper(Tone_mapping mode = tone_linear);
+
+	void set_mode(Tone_mapping mode_) { mode = mode_; }
+	void set_linear_gain(double gain);
+	void set_plateau(double plateau);//Fraction of the pixels, in ]0,1]
+
+	Tone_mapping get_mode() const { return mode; }
+	double get_linear_gain() const { return linear_gain; }
+	double get_plateau() const { return plateau; }
+
+	void apply(const cv::Mat& img16, cv::Mat& img8);//img16 has to be CV_16UC1, img8 is allocated if it does not have the right format
+
+	private:
+	Tone_mapping mode;
+	double linear_gain;
+	double plateau;
+
+	std::vector<uint32_t> histogram;//Indexed from the minimum of the image
+	std::vector<uint8_t> lut;//Indexed from the minimum of the image
+
+	void build_lut(const cv::Mat& img16, uint16_t min_value, uint16_t max_value, uint64_t sum);
+	void build_equalization_lut(uint32_t bin_limit);
+}; //class Tone_mapper
+
+} //namespace cam
+
+#endif
@@ -5,37 +5,159 @@
 #include <termios.h>
 #endif
 
+#include "util_clock.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
 #include <string>
+#include <thread>
 
 namespace cam {
 
-static constexpr char trigger_byte = 0x00;//Byte to send for activating the trigger
+//Messages exchanged with the trigger device (trigger/trigger.ino) :
+//sync byte, message type, payload length, payload (little endian), XOR of the type, the length and the payload
+static constexpr uint8_t trigger_sync_byte = 0xA5;
+static constexpr uint8_t trigger_msg_trigger = 0x01;//Sequence id (2 bytes). The device sends one pulse and acknowledges it.
+static constexpr uint8_t trigger_msg_burst = 0x02;//First sequence id (2 bytes), number of pulses (2 bytes, 0 until stopped), period in us (4 bytes)
+static constexpr uint8_t trigger_msg_stop = 0x03;//No payload, stops the burst
+static constexpr uint8_t trigger_msg_ping = 0x04;//Sequence id (2 bytes). The device answers with trigger_msg_pong, without any pulse.
+static constexpr uint8_t trigger_msg_ack = 0x81;//Sent by the device for each pulse : sequence id (2 bytes), device time of the pulse in us (4 bytes)
+static constexpr uint8_t trigger_msg_pong = 0x84;//Sequence id of the ping (2 bytes)
+
+static constexpr int trigger_ack_timeout_ms = 50;//A trigger which is not acknowledged within this time is counted as lost
+static constexpr size_t trigger_ack_history = 256;//Number of acknowledgements kept, by sequence id
+static constexpr int trigger_ping_number = 10;//Number of pings sent at the opening to measure the round trip time
+static constexpr int trigger_ping_timeout_ms = 100;
+static constexpr int trigger_startup_ms = 3000;//Time given to the device to answer the first ping (an Arduino resets when the port is opened, its bootloader runs 1-2 s)
+static constexpr int trigger_latency_timer_ms = 1;//Latency timer of the FTDI converters (16 ms by default in the driver)
+
+struct Trigger_round_trip
+{
+	//Round trip time of a message between the host and the trigger device, measured at the opening
+	Trigger_round_trip() : samples(0), min_us(-1), mean_us(-1), max_us(-1) {}
+	int samples;//Number of pings answered, 0 if the device does not answer (the other values are then negative)
+	double min_us;
+	double mean_us;
+	double max_us;
+};
+
+struct Trigger_ack
+{
+	//Acknowledgement of a pulse by the trigger device
+	Trigger_ack() : seq(0), device_us(-1) {}
+	uint16_t seq;
+	int64_t device_us;//Time of the start of the pulse given by the device clock in microseconds (the 32 bits counter of the device is unwrapped)
+	clock_type::time_point sent_tp;//Time at which the trigger has been written, not set for the pulses of a burst
+	clock_type::time_point ack_tp;//Time at which the acknowledgement has been received
+	clock_type::time_point pulse_tp;//Time of the pulse in the host clock : device_us mapped with the estimated offset between the clocks (exact if the host generates the pulses)
+};
 
-class Trigger_vcp
+class Trigger
 {
+	//Interface of the external triggers used by the acquisition (serial device, GPIO line of the host, in-process loopback).
+	//Each pulse has a sequence id and is acknowledged with the time of the pulse in the clock of the device generating it.
+	public:
+	virtual ~Trigger() {}
+
+	virtual bool open_trigger() = 0;//Open the device with its configuration, does nothing if it is already opened. Returns is_opened().
+	virtual bool is_opened() const = 0;
+
+	virtual bool send_trigger() = 0;//Send a single trigger with the next sequence id, does not wait for the acknowledgement
+	virtual clock_type::time_point get_last_trigger_tp() const = 0;//Time at which the last trigger has been sent
+	virtual uint16_t get_last_trigger_seq() const = 0;//Sequence id of the last trigger sent
+
+	//The device sends count pulses every period_us (until stop_burst if count is 0), with the sequence ids following the last trigger.
+	//Each pulse is acknowledged, the ids can be matched with get_ack.
+	virtual bool start_burst(uint16_t count, uint32_t period_us) = 0;
+	virtual bool stop_burst() = 0;
+
+	virtual bool get_ack(uint16_t seq, Trigger_ack& ack) = 0;//Returns false if the acknowledgement of seq has not been received (yet), does not block
+	virtual bool get_pulse_before(const clock_type::time_point& tp, Trigger_ack& ack) = 0;//Acknowledgement of the latest pulse generated before tp (compared with pulse_tp), returns false if there is none in the history
+	virtual uint64_t get_lost_triggers() const = 0;//Number of triggers not acknowledged since the opening
+	virtual Trigger_round_trip get_round_trip() const { return Trigger_round_trip(); }//Latency between the host and the device, not measured if the host generates the pulses
+}; //class Trigger
+
+class Trigger_vcp : public Trigger
+{
+	//Trigger device on a serial port (trigger/trigger.ino)
 	public:
 	Trigger_vcp();
-	
+	#ifdef __unix__
+	Trigger_vcp(const std::string& port_name, const speed_t& baudrate);//Configuration used by open_trigger
+	#endif
+
 	virtual ~Trigger_vcp();
 
 	#ifdef __unix__
-	void open_vcp(const std::string& port_name, const speed_t& baudrate);
+	void open_vcp(const std::string& port_name, const speed_t& baudrate);//Also starts the thread reading the acknowledgements and measures the round trip time (waits up to trigger_startup_ms for the device)
 	#else
 	void open_vcp();
 	#endif
+	bool open_trigger() override;
 
-	bool send_trigger();
+	bool send_trigger() override;
+	clock_type::time_point get_last_trigger_tp() const override { return last_trigger_tp; }//Time at which the last trigger has been written
+	uint16_t get_last_trigger_seq() const override { return last_trigger_seq; }
 
-	bool is_opened() const
+	bool start_burst(uint16_t count, uint32_t period_us) override;
+	bool stop_burst() override;
+
+	bool get_ack(uint16_t seq, Trigger_ack& ack) override;
+	//The offset between the clocks is the smallest delay between the pulses and the reception of their acknowledgement in the history,
+	//minus half the minimum round trip time. If a pulse of the burst is due before tp, its acknowledgement is waited for (trigger_ack_timeout_ms at most).
+	bool get_pulse_before(const clock_type::time_point& tp, Trigger_ack& ack) override;
+	uint64_t get_lost_triggers() const override { return lost_triggers.load(); }
+	Trigger_round_trip get_round_trip() const override;//Write to acknowledgement latency of the serial link, the floor of the synchronization error between the cameras
+
+	bool is_opened() const override
 	{
 		return opened;
 	}
 
 	private:
+	struct Ack_slot
+	{
+		Ack_slot() : acked(false), lost(false) {}
+		Trigger_ack ack;
+		bool acked;
+		bool lost;//Already counted in lost_triggers
+	};
+
 	bool opened;//True if the device was opened correctly
 	int fd;//File descriptor
+	std::string config_port_name;//Port opened by open_trigger
+	#ifdef __unix__
+	speed_t config_baudrate;
+	#endif
+	clock_type::time_point last_trigger_tp;
+	uint16_t last_trigger_seq;
+	uint32_t burst_period_us;//Period of the current burst, 0 if none
+
+	mutable std::mutex mtx;//Protects the slots, the pings and the writes on the port
+	std::array<Ack_slot, trigger_ack_history> slots;//Indexed by the sequence id modulo trigger_ack_history
+	std::condition_variable ack_cv;//Notified by the reader thread for each acknowledgement
+	std::atomic<uint64_t> lost_triggers;
+
+	std::condition_variable pong_cv;//Notified by the reader thread for each pong
+	int last_pong_seq;//Negative if no pong has been received
+	Trigger_round_trip round_trip;
+
+	std::thread reader_thd;//Reads and matches the acknowledgements
+	std::atomic<bool> reader_should_run;
 
 	int set_interface_attribs(int fd, int speed);//Set the speed and flags of the VCP port
+	int set_low_latency(const std::string& port_name);//Reduce the buffering of the serial driver, returns 0 if success
+	void measure_round_trip();//The reader thread has to be running
+	bool send_message(uint8_t type, const uint8_t* payload, uint8_t length);//mtx has to be locked
+	void reader_func();
+	void receive_ack(uint16_t seq, int64_t device_us);
+	bool clock_offset_us(int64_t& offset_us) const;//Host time minus device time, in microseconds since the epoch of clock_type. mtx has to be locked.
+	const Ack_slot* latest_pulse_before(int64_t device_us) const;//mtx has to be locked
+	void receive_pong(uint16_t seq);
+	void check_lost_triggers(const clock_type::time_point& now);
 
 };
 } //end of cam namespace
@@ -0,0 +1,39 @@
+#ifndef UASL_IMAGE_ACQUISITION_TRIGGER_GPIO_HPP
+#define UASL_IMAGE_ACQUISITION_TRIGGER_GPIO_HPP
+
+#include "trigger_local.hpp"
+
+#include <string>
+
+namespace cam {
+
+static constexpr int gpio_pulse_us_d = 150;//Default duration of the pulse, same as trigger/trigger.ino
+
+class Trigger_gpio : public Trigger_local
+{
+	//Trigger generated on a GPIO line of the host through the character device of the GPIO chip (/dev/gpiochipN, Linux only).
+	//There is no USB-serial link between the host and the pulse : the acknowledgement is the time at which the line has been set.
+	//Please note that the user needs the read/write permissions on the chip device.
+	public:
+	Trigger_gpio(const std::string& chip_path, unsigned int line, bool active_low = true, int pulse_us = gpio_pulse_us_d);//active_low : the pulse is a low level, as with trigger.ino
+	virtual ~Trigger_gpio();
+
+	bool open_trigger() override;
+	bool is_opened() const override { return line_fd >= 0; }
+
+	protected:
+	bool fire_pulse(clock_type::time_point& pulse_tp) override;
+
+	private:
+	std::string chip_path;
+	unsigned int line;
+	bool active_low;
+	int pulse_us;
+	int line_fd;//File descriptor of the requested line, negative if not opened
+
+	int set_line(bool active);//Returns 0 if success
+}; //class Trigger_gpio
+
+} //end of cam namespace
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef UASL_IMAGE_ACQUISITION_TRIGGER_LOCAL_HPP
+#define UASL_IMAGE_ACQUISITION_TRIGGER_LOCAL_HPP
+
+#include "trigger.hpp"
+#include "util_clock.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace cam {
+
+class Trigger_local : public Trigger
+{
+	//Base of the triggers whose pulses are generated by the host itself (GPIO line, loopback) : the acknowledgement of a pulse is
+	//immediate, and its device time is the time of the pulse in the host clock (microseconds since the epoch of clock_type).
+	//The bursts are generated by a thread of this class. The derived classes only implement fire_pulse.
+	public:
+	Trigger_local();
+	virtual ~Trigger_local();//The derived classes have to call stop_pulses in their destructor, before releasing their device
+
+	bool send_trigger() override;
+	clock_type::time_point get_last_trigger_tp() const override;
+	uint16_t get_last_trigger_seq() const override;
+
+	bool start_burst(uint16_t count, uint32_t period_us) override;
+	bool stop_burst() override;
+
+	bool get_ack(uint16_t seq, Trigger_ack& ack) override;
+	bool get_pulse_before(const clock_type::time_point& tp, Trigger_ack& ack) override;
+	uint64_t get_lost_triggers() const override { return lost_triggers.load(); }//Pulses which could not be generated
+
+	protected:
+	virtual bool fire_pulse(clock_type::time_point& pulse_tp) = 0;//Generate one pulse, pulse_tp is the time of its start. Called with mtx locked.
+	void stop_pulses();//Stop the burst thread
+
+	private:
+	mutable std::mutex mtx;//Protects the acknowledgements and serializes the pulses
+	std::array<Trigger_ack, trigger_ack_history> slots;//Indexed by the sequence id modulo trigger_ack_history
+	std::array<bool, trigger_ack_history> acked;
+	clock_type::time_point last_trigger_tp;
+	uint16_t last_trigger_seq;
+	std::atomic<uint64_t> lost_triggers;
+
+	std::thread burst_thd;
+	std::mutex burst_mtx;//Protects the start and the stop of the burst thread
+	std::atomic<bool> burst_should_run;
+
+	bool pulse(uint16_t seq, const clock_type::time_point& sent_tp);//mtx has to be locked
+	void burst_func(uint16_t first_seq, uint16_t count, uint32_t period_us);
+}; //class Trigger_local
+
+} //end of cam namespace
+
+#endif
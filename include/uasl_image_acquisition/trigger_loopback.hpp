@@ -0,0 +1,46 @@
+#ifndef UASL_IMAGE_ACQUISITION_TRIGGER_LOOPBACK_HPP
+#define UASL_IMAGE_ACQUISITION_TRIGGER_LOOPBACK_HPP
+
+#include "trigger_local.hpp"
+#include "util_clock.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace cam {
+
+static constexpr size_t loopback_pulse_history = 16;//Number of pulses a late camera can still catch up with
+
+class Trigger_loopback : public Trigger_local
+{
+	//In-process trigger, without any hardware : the pulses are given to the simulated cameras sharing this trigger
+	//(see SyntheticParameters::set_trigger), which makes the multi-camera code path of the acquisition usable without devices.
+	public:
+	Trigger_loopback();
+	virtual ~Trigger_loopback();
+
+	bool open_trigger() override { return true; }
+	bool is_opened() const override { return true; }
+
+	uint64_t get_pulse_count() const;//Number of pulses since the creation
+
+	//Wait for the pulse following the pulse number last_pulse (0 for the first one), then update last_pulse.
+	//If the camera is late by more than loopback_pulse_history pulses, the oldest pulse still in the history is given.
+	//Returns false in case of timeout.
+	bool wait_pulse(uint64_t& last_pulse, clock_type::time_point& pulse_tp, int timeout_ms);
+
+	protected:
+	bool fire_pulse(clock_type::time_point& pulse_tp) override;
+
+	private:
+	mutable std::mutex pulse_mtx;
+	std::condition_variable pulse_cv;
+	uint64_t pulse_count;
+	std::array<clock_type::time_point, loopback_pulse_history> pulse_history;//Time of the pulse k at index k modulo loopback_pulse_history
+}; //class Trigger_loopback
+
+} //end of cam namespace
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef UASL_IMAGE_ACQUISITION_UTIL_THREAD_HPP
+#define UASL_IMAGE_ACQUISITION_UTIL_THREAD_HPP
+
+namespace cam
+{
+
+struct Thread_config
+{
+	//Scheduling of a thread. By default, the thread is left to the scheduler.
+	Thread_config(int cpu_ = -1, int rt_priority_ = 0) : cpu(cpu_), rt_priority(rt_priority_) {}
+	int cpu;//Core on which the thread is pinned, negative to let the scheduler choose
+	int rt_priority;//Priority of the real-time scheduling (SCHED_FIFO, 1 to 99), 0 to keep the normal scheduling
+
+	bool is_default() const { return cpu < 0 && rt_priority <= 0; }
+};
+
+struct Thread_policy
+{
+	//Scheduling of the threads involved in the acquisition (see Acquisition::set_thread_policy).
+	//Pinning the time critical threads on isolated cores, with the real-time scheduling, reduces the jitter between
+	//the trigger and the arrival of the frames when the system is loaded. The real-time scheduling needs the CAP_SYS_NICE
+	//capability (or a suitable RLIMIT_RTPRIO), otherwise a warning is printed and the normal scheduling is kept.
+	Thread_config acquisition;//Acquisition thread : trigger, retrieval of the images (unless the parallel retrieval is used), assembly of the sets
+	Thread_config retrieval;//Retrieval threads used by the parallel retrieval (all the cameras share the configuration)
+	Thread_config usb_events;//Threads of the camera drivers handling the USB transfers
+	Thread_config decoder;//Threads of the camera drivers decoding the images
+};
+
+//Apply a configuration to the calling thread. A default configuration does not change the thread.
+//Returns 0 on success, -1 if the core could not be set, -2 if the scheduling could not be set, -3 if not supported on this system.
+int apply_thread_config(const Thread_config& config);
+
+} //namespace cam
+#endif
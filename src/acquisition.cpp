@@ -1,5 +1,6 @@
 #include "acquisition.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 #include <typeinfo>
 #include <chrono>
@@ -12,12 +13,21 @@ namespace cam {
 Acquisition::Acquisition(const clock_type::time_point& time_origin)
 				: should_run(false)
 				, acq_start_package(*this)
-				, images_have_been_returned(true)
+				, next_seq(0)
+				, default_ring(std::make_shared<Frame_ring>(default_ring_depth, overwrite_oldest))
+				, rings(std::make_shared<const Ring_vec>(1, default_ring))
 				, trigger_port_name(port_name_d)
 				, trigger_baudrate(baudrate_d)
+				, trigger_period_us(0)
+				, parallel_retrieval(false)
+				, sync_tolerance_us(0)
+				, sync_policy(drop_incomplete)
+				, sync_dropped_frames(0)
+				, param_posted(0)
+				, param_applied(0)
+				, latency_report_period_ms(0)
 				, origin_tp(time_origin)
                 , current_tp(origin_tp)
-				, timestamp(0)
 {}
 
 Acquisition::~Acquisition()
@@ -60,6 +70,9 @@ int Acquisition::stop_acq()
 	if(acq_thd.joinable())
         acq_thd.join();
 
+	//Modifications left by a thread which ended before applying them
+	std::lock_guard<std::mutex> lock_cam(camera_vec_mtx);
+	apply_param_commands(false, camera_vec.size() == 1);
 
 	return 0;
 }
@@ -81,7 +94,7 @@ bool Acquisition::is_running()
 Camera_params& Acquisition::get_cam_params(size_t idx)
 {
 	//Get the parameters of a given camera. Throw exceptions if the index is invalid (the return type is preferred to an error code for usability reasons
-	stop_acq();
+	//The acquisition is not stopped : the parameters posting their modifications (Camera_params::post_command) are applied between two frames.
 
 	//Lock the camera vector
 	std::lock_guard<std::mutex> lock_cam(camera_vec_mtx);
@@ -94,27 +107,125 @@ Camera_params& Acquisition::get_cam_params(size_t idx)
 	return camera_vec[idx]->get_params();
 }
 
+void Acquisition::post_param_command(const Param_command& command)
+{
+	std::lock_guard<std::mutex> lock_start(acq_start_package.mtx);//Prevents the acquisition from starting or stopping in the meantime
+	if(acq_thd.joinable() && !should_run.load())
+	{
+		//The thread has ended by itself (error) or is ending : it is joined as in stop_acq, after it applied the commands already queued
+		acq_thd.join();
+	}
+
+	{//Mutex scope
+		std::lock_guard<std::mutex> lock(param_queue_mtx);
+		++param_posted;
+		if(acq_thd.joinable())
+		{
+			//The acquisition thread applies the command before the next frame
+			param_queue.push_back(command);
+			return;
+		}
+	}
+
+	command.apply();
+	{//Mutex scope
+		std::lock_guard<std::mutex> lock(param_queue_mtx);
+		++param_applied;
+	}
+	param_queue_cv.notify_all();
+}
+
+bool Acquisition::wait_param_commands(int timeout_ms)
+{
+	std::unique_lock<std::mutex> lock(param_queue_mtx);
+	const uint64_t target = param_posted;
+	return param_queue_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this, target]{return param_applied >= target;});
+}
+
 int64_t Acquisition::get_images(std::vector<cv::Mat>& img_vec_out)
 {
-	std::unique_lock<std::mutex> mlock(images_ready_mtx);//Lock the images vector
-	bool success = !images_have_been_returned? true : images_have_changed.wait_for(mlock, std::chrono::milliseconds(timeout_ms), [this]{return !images_have_been_returned;});
-	if(!success) return -1;
+	Frame_set_ptr frame_set;
+	const int64_t ret = get_frames(frame_set);
+	if(ret < 0) return ret;
 
-	std::lock_guard<std::mutex> lock_images(images_vec_mtx);
-	img_vec_out.resize(images_vec.size());
-	for(size_t i = 0; i < images_vec.size(); ++i)
+	//The copy is done without holding any lock, so that the acquisition thread is never blocked by the caller
+	img_vec_out.resize(frame_set->images.size());
+	for(size_t i = 0; i < frame_set->images.size(); ++i)
 	{
-		images_vec[i].copyTo(img_vec_out[i]);
+		frame_set->images[i].copyTo(img_vec_out[i]);
 	}
 
-	images_have_been_returned = true;
+	return ret;
+}
+
+int64_t Acquisition::get_frames(Frame_set_ptr& frame_set)
+{
+	if(!default_ring->pop(frame_set, timeout_ms)) return -1;
+	latency.record(stage_consumed, frame_set->published_tp, clock_type::now());
 
-	return timestamp;
+	return frame_set->timestamp;
+}
+
+std::shared_ptr<Frame_ring> Acquisition::subscribe(size_t depth, Overflow_policy policy)
+{
+	std::shared_ptr<Frame_ring> ring = std::make_shared<Frame_ring>(depth, policy);
+
+	std::lock_guard<std::mutex> lock(rings_mtx);
+	std::shared_ptr<Ring_vec> new_rings = std::make_shared<Ring_vec>(*std::atomic_load(&rings));
+	new_rings->push_back(ring);
+	std::atomic_store(&rings, std::shared_ptr<const Ring_vec>(std::move(new_rings)));//The acquisition thread sees the new ring from the next set
+
+	return ring;
+}
+
+void Acquisition::unsubscribe(const std::shared_ptr<Frame_ring>& ring)
+{
+	if(ring == default_ring) return;
+
+	std::lock_guard<std::mutex> lock(rings_mtx);
+	std::shared_ptr<Ring_vec> new_rings = std::make_shared<Ring_vec>(*std::atomic_load(&rings));
+	for(Ring_vec::iterator it = new_rings->begin(); it != new_rings->end(); ++it)
+	{
+		if(*it == ring)
+		{
+			new_rings->erase(it);
+			break;
+		}
+	}
+	std::atomic_store(&rings, std::shared_ptr<const Ring_vec>(std::move(new_rings)));
+}
+
+//Camera_params : defined here since it needs the acquisition
+void Camera_params::post_command(const std::function<void()>& apply, bool live)
+{
+	Param_command command;
+	command.apply = apply;
+	command.live = live;
+	command.params = this;
+	package.acq_ref.post_param_command(command);
+}
+
+uint64_t Acquisition::get_dropped_sets()
+{
+	return default_ring->dropped();
 }
 
 //Private functions:
 void Acquisition::thread_func()
 {
+	std::vector<std::unique_ptr<Retrieval_worker>> workers;//Retrieval threads, one per camera if the parallel retrieval is used
+	std::unique_ptr<Frame_synchronizer> synchronizer;//Used if a synchronization tolerance is set
+	std::vector<cv::Mat> sync_images;//Images given to the synchronizer
+	std::vector<Frame_info> sync_info;
+	std::vector<int> results;//Value returned by each camera for the current set
+	bool trigger_needed = false;//The trigger is only needed if several cameras are used and one of them is triggered
+	Thread_policy policy;
+
+	{//Mutex scope
+		std::lock_guard<std::mutex> lock_policy(thread_policy_mtx);
+		policy = thread_policy;
+	}
+	apply_thread_config(policy.acquisition);
 
 	{//Mutex scope
 		std::lock_guard<std::mutex> lock_cam(camera_vec_mtx);//Lock the camera vector mutex
@@ -123,87 +234,326 @@ void Acquisition::thread_func()
 		if(cam_number == 0)
 		{
 			std::cerr << "Error : trying to launch an acquisition without cameras." << std::endl;
-			stop_acq();
+			should_run.store(false);//Do not call stop_acq() here : it would join this thread
 
 			return;
 		}
 
 		const bool only_one_camera = (cam_number == 1);//If there is a unique camera
 
+		for(size_t i = 0;i<cam_number && !only_one_camera; ++i)
+		{
+			trigger_needed = trigger_needed || camera_vec[i]->needs_external_trigger();
+		}
+
 		//Open the trigger if more than 1 camera is started
-		if(!only_one_camera)
+		if(trigger_needed)
 		{
-			#ifdef __unix__
-			{//Lock for the port_name, if one day atomic strings exist, feel free to obliterate this horror
-				std::lock_guard<std::mutex> lock_trigger_portname(trigger_port_name_mtx);
-				trigger.open_vcp(trigger_port_name, trigger_baudrate.load());
+			{//Mutex scope
+				std::lock_guard<std::mutex> lock_trigger(trigger_mtx);
+				if(!custom_trigger && !vcp_trigger)
+				{
+					#ifdef __unix__
+					//Lock for the port_name, if one day atomic strings exist, feel free to obliterate this horror
+					std::lock_guard<std::mutex> lock_trigger_portname(trigger_port_name_mtx);
+					vcp_trigger = std::make_shared<Trigger_vcp>(trigger_port_name, trigger_baudrate.load());
+					#else
+					vcp_trigger = std::make_shared<Trigger_vcp>();
+					#endif
+				}
+				running_trigger = custom_trigger ? custom_trigger : vcp_trigger;
 			}
-			#else
-			trigger.open_vcp()
-			#endif
-			
-			if(!trigger.is_opened())
+
+			if(!running_trigger->open_trigger())
 			{
 				std::cerr << "Trigger could not be opened. Aborting acquisition." << std::endl;
-				stop_acq();
+				should_run.store(false);
 			}
 		}
 
+		apply_param_commands(false, only_one_camera);//Modifications posted while the previous acquisition was ending
+
 		//Start the acquisition for all cameras. Returns 0 if success, else an error code.
 		for(size_t i = 0;i<cam_number && should_run.load(); ++i)
 		{
+			if(camera_vec[i]->set_thread_policy(policy) != 0)
+			{
+				std::cerr << "Warning : the thread policy could not be fully applied to camera " << i << "." << std::endl;
+			}
 			if(camera_vec[i]->start_acq(only_one_camera) != 0)
 			{
 				std::cerr << "Camera " << i << " could not be started. Aborting acquisition." << std::endl;
 				should_run.store(false);
 			}
 		}
+
+		if(!only_one_camera && parallel_retrieval.load())
+		{
+			for(size_t i = 0;i<cam_number; ++i)
+			{
+				workers.push_back(std::unique_ptr<Retrieval_worker>(new Retrieval_worker(*camera_vec[i], policy.retrieval)));
+			}
+		}
+
+		if(!only_one_camera && sync_tolerance_us.load() > 0)
+		{
+			synchronizer = std::unique_ptr<Frame_synchronizer>(new Frame_synchronizer(cam_number, sync_tolerance_us.load(), sync_policy.load(), sync_max_wait_us));
+			sync_images.resize(cam_number);
+			sync_info.resize(cam_number);
+			sync_dropped_frames.store(0);
+		}
 	}
 
+	latency.reset();
+	clock_type::time_point last_report_tp = clock_type::now();
+	uint32_t running_period_us = 0;//Period of the pulse train currently generated by the trigger device
+	int trigger_failures = 0;//Consecutive failures of the configuration of the free running trigger
+
 	while(should_run.load())
 	{
+		//Start, change or stop the free running trigger
+		const uint32_t period_us = trigger_needed ? trigger_period_us.load() : 0;
+		if(period_us != running_period_us)
+		{
+			const bool success = period_us > 0 ? running_trigger->start_burst(0, period_us) : running_trigger->stop_burst();
+			if(!success)
+			{
+				if(++trigger_failures >= trigger_max_failures)
+				{
+					std::cerr << "The free running trigger could not be configured. Aborting acquisition." << std::endl;
+					should_run.store(false);
+					break;
+				}
+				std::cerr << "Error during the configuration of the free running trigger, new attempt in " << trigger_retry_ms << " ms." << std::endl;
+				std::this_thread::sleep_for(std::chrono::milliseconds(trigger_retry_ms));
+				continue;
+			}
+			running_period_us = period_us;
+			trigger_failures = 0;
+		}
+		const bool free_running = running_period_us > 0;
+
+		{//Mutex scope
+			//Modifications of the parameters, between two frames
+			std::lock_guard<std::mutex> lock_cam(camera_vec_mtx);
+			apply_param_commands(true, camera_vec.size() == 1);
+		}
+
 		//Send the trigger
-		if(trigger.is_opened() && !trigger.send_trigger())
+		const clock_type::time_point trigger_start_tp = clock_type::now();
+		if(trigger_needed && !free_running && !running_trigger->send_trigger())
 		{
 			std::cerr << "Error during triggering." << std::endl;
 			continue;
 		}
         current_tp = clock_type::now();
 
+		clock_type::time_point trigger_tp;//Not set if there is no trigger
+		int trigger_seq = -1;
+		if(trigger_needed && !free_running)
+		{
+			trigger_tp = running_trigger->get_last_trigger_tp();
+			trigger_seq = running_trigger->get_last_trigger_seq();
+			latency.record(stage_trigger, trigger_start_tp, trigger_tp);
+		}
+
+		const int report_period_ms = latency_report_period_ms.load();
+		if(report_period_ms > 0 && current_tp - last_report_tp >= std::chrono::milliseconds(report_period_ms))
+		{
+			std::cout << "Latency of the acquisition stages :" << std::endl;
+			latency.print(std::cout);
+			last_report_tp = current_tp;
+		}
+
 		std::lock_guard<std::mutex> lock_cam(camera_vec_mtx);//Lock the camera vector mutex for all the duration of the processing
 
         const size_t cam_number = camera_vec.size();
 
-		bool acquisition_ok = true; //If the acquisition is valid
+		//Second, get the acquired pictures directly in a set from the pool, no lock is needed since the set is not shared yet
+		std::shared_ptr<Frame_set> new_set = frame_pool.acquire(cam_number);
 
-		//Second, get the acquired pictures
-		{//Mutex scope
-			std::lock_guard<std::mutex> lock_img(images_vec_mtx);//Lock the vector of images
+		if(synchronizer)
+		{
+			//Each valid image goes to the synchronizer, which decides which sets are complete
+			retrieve_set(sync_images, sync_info, results, workers, trigger_tp, trigger_seq, free_running);
 			for(size_t i = 0;i<cam_number; ++i)
 			{
-				if(camera_vec[i]->retrieve_image(images_vec[i]) != 0)
-				{
-					acquisition_ok = false;//By design, the size of camera_vec and image_vec should be the same
-				}
+				if(results[i] == 0) synchronizer->push(i, sync_images[i], sync_info[i]);
+			}
+
+			clock_type::time_point set_tp;
+			while(synchronizer->pop_set(*new_set, set_tp, clock_type::now()))
+			{
+				new_set->timestamp = std::chrono::duration_cast<std::chrono::duration<int64_t,std::micro>>(set_tp-origin_tp).count();
+				new_set->seq = next_seq++;
+
+				publish(std::move(new_set));
+				new_set = frame_pool.acquire(cam_number);
+			}
+			sync_dropped_frames.store(synchronizer->get_dropped_frames());
+		}
+		else if(retrieve_set(new_set->images, new_set->frame_info, results, workers, trigger_tp, trigger_seq, free_running))//If the acquisition is valid
+		{
+		    new_set->timestamp = std::chrono::duration_cast<std::chrono::duration<int64_t,std::micro>>(current_tp-origin_tp).count();
+			new_set->seq = next_seq++;
+
+			publish(std::move(new_set));
+		}
+	}
+
+	if(running_period_us > 0) running_trigger->stop_burst();
+	workers.clear();//Join the retrieval threads before stopping the cameras
+	close_cameras();
+
+	std::lock_guard<std::mutex> lock_cam(camera_vec_mtx);
+	apply_param_commands(false, camera_vec.size() == 1);//The cameras are stopped, nothing is restarted
+}
+
+bool Acquisition::retrieve_set(std::vector<cv::Mat>& images, std::vector<Frame_info>& info, std::vector<int>& results, std::vector<std::unique_ptr<Retrieval_worker>>& workers, const clock_type::time_point& trigger_tp, int trigger_seq, bool free_running)
+{
+	const size_t cam_number = camera_vec.size();
+	bool acquisition_ok = true;
+	results.resize(cam_number);
+
+	for(size_t i = 0;i<cam_number; ++i)
+	{
+		info[i] = Frame_info();//The timestamps of a recycled set must not be mistaken for the ones of the new images
+	}
+
+	if(workers.size() == cam_number)
+	{
+		//Start all the retrievals, then wait for all of them
+		for(size_t i = 0;i<cam_number; ++i)
+		{
+			workers[i]->post(images[i], info[i]);
+		}
+		for(size_t i = 0;i<cam_number; ++i)
+		{
+			results[i] = workers[i]->wait();
+		}
+	}
+	else
+	{
+		for(size_t i = 0;i<cam_number; ++i)
+		{
+			results[i] = camera_vec[i]->retrieve_frame(images[i], info[i]);//By design, the size of camera_vec and of the images should be the same
+			info[i].retrieved_tp = clock_type::now();
+		}
+	}
+
+	//The acknowledgement is read by the trigger thread, it usually arrives before the end of the exposure
+	Trigger_ack ack;
+	const bool acked = trigger_seq >= 0 && running_trigger->get_ack(static_cast<uint16_t>(trigger_seq), ack);
+
+	for(size_t i = 0;i<cam_number; ++i)
+	{
+		if(results[i] != 0)
+		{
+			acquisition_ok = false;
+		}
+		else if(free_running)
+		{
+			//The pulse of the image is the latest one generated before its arrival, if the exposure and the transfer are shorter than the period
+			const clock_type::time_point arrival_tp = info[i].usb_tp != clock_type::time_point() ? info[i].usb_tp : info[i].host_tp;
+			Trigger_ack pulse_ack;
+			if(running_trigger->get_pulse_before(arrival_tp, pulse_ack))
+			{
+				info[i].trigger_tp = pulse_ack.pulse_tp;//Time of the pulse itself, the latency stages start from it
+				info[i].trigger_device_us = pulse_ack.device_us;
 			}
+			latency.record_frame(info[i]);
+		}
+		else
+		{
+			info[i].trigger_tp = trigger_tp;
+			if(acked) info[i].trigger_device_us = ack.device_us;
+			latency.record_frame(info[i]);
 		}
+	}
+
+	if(!acquisition_ok && trigger_seq >= 0 && !acked)
+	{
+		std::cerr << "Warning : the trigger " << trigger_seq << " has not been acknowledged by the trigger device." << std::endl;
+	}
+
+	return acquisition_ok;
+}
+
+void Acquisition::publish(const std::shared_ptr<Frame_set>& frame_set)
+{
+	//The publication is measured from the last image of the set
+	clock_type::time_point last_retrieved_tp;
+	for(const Frame_info& info : frame_set->frame_info)
+	{
+		last_retrieved_tp = std::max(last_retrieved_tp, info.retrieved_tp);
+	}
+	frame_set->published_tp = clock_type::now();
+	latency.record(stage_published, last_retrieved_tp, frame_set->published_tp);
 
-		if(acquisition_ok)
+	std::shared_ptr<const Ring_vec> current_rings = std::atomic_load(&rings);//camera_vec_mtx is not needed, the vector is never modified once published
+	for(const std::shared_ptr<Frame_ring>& ring : *current_rings)
+	{
+		ring->push(frame_set, timeout_ms);//The set is dropped if a block_producer ring stays full for more than timeout_ms
+	}
+}
+
+void Acquisition::clear_rings()
+{
+	std::shared_ptr<const Ring_vec> current_rings = std::atomic_load(&rings);
+	for(const std::shared_ptr<Frame_ring>& ring : *current_rings)
+	{
+		ring->clear();
+	}
+}
+
+void Acquisition::apply_param_commands(bool cameras_started, bool only_one_camera)
+{
+	std::vector<Param_command> commands;
+	{//Mutex scope
+		std::lock_guard<std::mutex> lock(param_queue_mtx);
+		if(param_queue.empty()) return;
+		commands.swap(param_queue);
+	}
+
+	//Only the cameras with a command which is not live are restarted, once for all their commands
+	const size_t cam_number = camera_vec.size();
+	std::vector<bool> restart_needed(cam_number, false);
+	for(const Param_command& command : commands)
+	{
+		for(size_t i = 0;i<cam_number && cameras_started && !command.live; ++i)
 		{
-			std::lock_guard<std::mutex> lock_ready(images_ready_mtx);
-		    timestamp = std::chrono::duration_cast<std::chrono::duration<int64_t,std::micro>>(current_tp-origin_tp).count();
-			images_have_been_returned = false;
+			if(&camera_vec[i]->get_params() == command.params) restart_needed[i] = true;
 		}
+	}
 
+	//The commands are applied in the order of posting
+	for(size_t i = 0;i<cam_number; ++i)
+	{
+		if(restart_needed[i] && camera_vec[i]->stop_acq() != 0)
+		{
+			std::cerr << "Camera " << i << " could not be stopped." << std::endl;
+		}
+	}
 
-		if(acquisition_ok)
+	for(const Param_command& command : commands)
+	{
+		command.apply();
+	}
+
+	for(size_t i = 0;i<cam_number; ++i)
+	{
+		if(restart_needed[i] && camera_vec[i]->start_acq(only_one_camera) != 0)
 		{
-			//If the acquisition is successful, update the status to indicate that new images have been taken
-			images_have_changed.notify_all();
+			std::cerr << "Camera " << i << " could not be started again after a modification of the parameters. Aborting acquisition." << std::endl;
+			should_run.store(false);
 		}
 	}
 
-	close_cameras();
+	{//Mutex scope
+		std::lock_guard<std::mutex> lock(param_queue_mtx);
+		param_applied += commands.size();
+	}
+	param_queue_cv.notify_all();
 }
 
 void Acquisition::close_cameras()
@@ -233,9 +583,113 @@ void Acquisition::set_trigger_baurate(const speed_t& baudrate_){
     stop_acq();
 
 	trigger_baudrate.store(baudrate_);
+	reset_vcp_trigger();
 }
 #endif
 
+bool Acquisition::get_parallel_retrieval() const{
+
+	return parallel_retrieval.load();
+}
+
+void Acquisition::set_parallel_retrieval(bool parallel_){
+
+    stop_acq();
+
+	parallel_retrieval.store(parallel_);
+}
+
+Thread_policy Acquisition::get_thread_policy(){
+
+	std::lock_guard<std::mutex> lock(thread_policy_mtx);
+	return thread_policy;
+}
+
+void Acquisition::set_thread_policy(const Thread_policy& policy){
+
+	stop_acq();
+
+	std::lock_guard<std::mutex> lock(thread_policy_mtx);
+	thread_policy = policy;
+}
+
+Latency_summary Acquisition::get_latency(Latency_stage stage) const{
+
+	return latency.summary(stage);
+}
+
+void Acquisition::print_latency(std::ostream& stream) const{
+
+	latency.print(stream);
+}
+
+void Acquisition::reset_latency(){
+
+	latency.reset();
+}
+
+void Acquisition::set_latency_report_period(int period_ms){
+
+	latency_report_period_ms.store(period_ms > 0 ? period_ms : 0);
+}
+
+int64_t Acquisition::get_sync_tolerance_us() const{
+
+	return sync_tolerance_us.load();
+}
+
+void Acquisition::set_sync_tolerance_us(int64_t tolerance_us_, Straggler_policy policy_){
+
+    stop_acq();
+
+	sync_tolerance_us.store(tolerance_us_ > 0 ? tolerance_us_ : 0);
+	sync_policy.store(policy_);
+}
+
+uint64_t Acquisition::get_sync_dropped_frames() const{
+
+	return sync_dropped_frames.load();
+}
+
+uint32_t Acquisition::get_trigger_period_us() const{
+
+	return trigger_period_us.load();
+}
+
+void Acquisition::set_trigger_period_us(uint32_t period_us_){
+
+	trigger_period_us.store(period_us_);//Applied by the acquisition thread, without stopping the acquisition
+}
+
+Trigger_round_trip Acquisition::get_trigger_round_trip() const{
+
+	std::lock_guard<std::mutex> lock(trigger_mtx);
+	const std::shared_ptr<Trigger> current = custom_trigger ? custom_trigger : vcp_trigger;
+	return current ? current->get_round_trip() : Trigger_round_trip();
+}
+
+uint64_t Acquisition::get_lost_triggers() const{
+
+	std::lock_guard<std::mutex> lock(trigger_mtx);
+	const std::shared_ptr<Trigger> current = custom_trigger ? custom_trigger : vcp_trigger;
+	return current ? current->get_lost_triggers() : 0;
+}
+
+std::shared_ptr<Trigger> Acquisition::get_trigger(){
+
+	std::lock_guard<std::mutex> lock(trigger_mtx);
+	return custom_trigger;
+}
+
+void Acquisition::set_trigger(const std::shared_ptr<Trigger>& trigger_){
+
+	stop_acq();
+
+	std::lock_guard<std::mutex> lock(trigger_mtx);
+	custom_trigger = trigger_;
+	running_trigger.reset();
+}
+
 std::string Acquisition::get_trigger_port_name(){
 	
 	std::lock_guard<std::mutex> lock(trigger_port_name_mtx);
@@ -246,8 +700,19 @@ void Acquisition::set_trigger_port_name(const std::string& portname_){
 
     stop_acq();
 	
-	std::lock_guard<std::mutex> lock(trigger_port_name_mtx);
-	trigger_port_name = portname_;
+	{//Mutex scope
+		std::lock_guard<std::mutex> lock(trigger_port_name_mtx);
+		trigger_port_name = portname_;
+	}
+	reset_vcp_trigger();
+}
+
+void Acquisition::reset_vcp_trigger(){
+
+	//The serial trigger is opened again with the new configuration at the next start
+	std::lock_guard<std::mutex> lock(trigger_mtx);
+	vcp_trigger.reset();
+	running_trigger.reset();
 }
 
 } //namespace cam
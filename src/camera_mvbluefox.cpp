@@ -16,9 +16,64 @@ std::unique_ptr<Camera_seq> Camera_seq::get_instance<bluefox>(Cond_var_package&
 //BlueFoxParameters : Public functions
 void BlueFoxParameters::set_image_size(int width, int height)
 {
-	Acquisition_lock lock(package);//If the function modifies the parameters, always call the lock at the very beginning
+	post_command([this, width, height]{apply_image_size(width, height);}, false);
+}
+
+void BlueFoxParameters::set_image_roi(int startx, int starty, int width, int height)
+{
+	post_command([this, startx, starty, width, height]{apply_image_roi(startx, starty, width, height);}, false);
+}
+
+void BlueFoxParameters::set_agc(bool value)
+{
+	post_command([this, value]{apply_agc(value);}, true);
+}
+
+void BlueFoxParameters::set_aec(bool value)
+{
+	post_command([this, value]{apply_aec(value);}, true);
+}
+
+void BlueFoxParameters::set_image_type(int ocv_color_code)
+{
+	post_command([this, ocv_color_code]{apply_image_type(ocv_color_code);}, false);
+}
+
+void BlueFoxParameters::set_trigger_mode(mvIMPACT::acquire::TCameraTriggerMode trigger_mode)
+{
+	post_command([this, trigger_mode]{apply_trigger_mode(trigger_mode);}, false);
+}
+
+void BlueFoxParameters::set_trigger_source(mvIMPACT::acquire::TCameraTriggerSource trigger_source)
+{
+	post_command([this, trigger_source]{apply_trigger_source(trigger_source);}, false);
+}
+
+void BlueFoxParameters::set_exposure_time(int exposure_time_us)
+{
+	post_command([this, exposure_time_us]{apply_exposure_time(exposure_time_us);}, true);
+}
+
+void BlueFoxParameters::set_gain(double gain_db)
+{
+	post_command([this, gain_db]{apply_gain(gain_db);}, true);
+}
+
+void BlueFoxParameters::set_pixelclock(mvIMPACT::acquire::TCameraPixelClock pixelclock)
+{
+	post_command([this, pixelclock]{apply_pixelclock(pixelclock);}, false);
+}
+
+void BlueFoxParameters::set_request_timeout_ms(int timeout_ms)
+{
+	post_command([this, timeout_ms]{apply_request_timeout_ms(timeout_ms);}, true);
+}
+
+//BlueFoxParameters : Private functions
+void BlueFoxParameters::apply_image_size(int width, int height)
+{
 	//Set the image size, if the value is negative, keep former value, if value is 0, set it to the maximum value if available
-	if(!check_cam() || !lock.is_valid()) return;
+	if(!check_cam()) return;
 
     mvIMPACT::acquire::CameraSettingsBlueFOX cam_settings(p_dev);
     if(width > 0) cam_settings.aoiWidth.write(width);
@@ -41,11 +96,10 @@ void BlueFoxParameters::set_image_size(int width, int height)
     }
 }
 
-void BlueFoxParameters::set_image_roi(int startx, int starty, int width, int height)
+void BlueFoxParameters::apply_image_roi(int startx, int starty, int width, int height)
 {
-	Acquisition_lock lock(package);//If the function modifies the parameters, always call the lock at the very beginning
 	// Set the image ROI, if the height/width is negative, keep former value, if value is 0, set it to the maximum value if available.
-	if(!check_cam() || !lock.is_valid()) return;
+	if(!check_cam()) return;
 
     mvIMPACT::acquire::CameraSettingsBlueFOX cam_settings(p_dev);
     if(startx >=0 && startx < width) cam_settings.aoiStartX .write(startx);
@@ -70,10 +124,9 @@ void BlueFoxParameters::set_image_roi(int startx, int starty, int width, int hei
     }
 }
 
-void BlueFoxParameters::set_agc(bool value)
+void BlueFoxParameters::apply_agc(bool value)
 {
-	Acquisition_lock lock(package);//If the function modifies the parameters, always call the lock at the very beginning
-	if(!check_cam() || !lock.is_valid()) return;
+	if(!check_cam()) return;
 
     mvIMPACT::acquire::CameraSettingsBlueFOX cam_settings(p_dev);
     mvIMPACT::acquire::TAutoGainControl agc_val = value ? agcOn : agcOff;
@@ -85,10 +138,9 @@ void BlueFoxParameters::set_agc(bool value)
     }
 }
 
-void BlueFoxParameters::set_aec(bool value)
+void BlueFoxParameters::apply_aec(bool value)
 {
-	Acquisition_lock lock(package);//If the function modifies the parameters, always call the lock at the very beginning
-	if(!check_cam() || !lock.is_valid()) return;
+	if(!check_cam()) return;
 
     mvIMPACT::acquire::CameraSettingsBlueFOX cam_settings(p_dev);
     mvIMPACT::acquire::TAutoExposureControl aec_val = value ? aecOn : aecOff;
@@ -100,12 +152,11 @@ void BlueFoxParameters::set_aec(bool value)
     }
 }
 
-void BlueFoxParameters::set_image_type(int ocv_color_code)
+void BlueFoxParameters::apply_image_type(int ocv_color_code)
 {
-	Acquisition_lock lock(package);//If the function modifies the parameters, always call the lock at the very beginning
 	//Set both the acquisition type and the transfer type to the same value
     //Supported : CV_8U, CV_16U, CV_8UC3 (see OpenCV documentation for details)
-	if(!check_cam() || !lock.is_valid()) return;
+	if(!check_cam()) return;
 
     mvIMPACT::acquire::TImageDestinationPixelFormat pixel_format_destination;
     //From what I understand, the ImageBuffer pixelFormat is related to the format for sending the image, however, the
@@ -135,10 +186,9 @@ void BlueFoxParameters::set_image_type(int ocv_color_code)
     image_destination_settings.pixelFormat.write(pixel_format_destination);
 }
 
-void BlueFoxParameters::set_trigger_mode(mvIMPACT::acquire::TCameraTriggerMode trigger_mode)
+void BlueFoxParameters::apply_trigger_mode(mvIMPACT::acquire::TCameraTriggerMode trigger_mode)
 {
-	Acquisition_lock lock(package);//If the function modifies the parameters, always call the lock at the very beginning
-	if(!check_cam() || !lock.is_valid()) return;
+	if(!check_cam()) return;
 
 	mvIMPACT::acquire::CameraSettingsBlueFOX cam_settings(p_dev);
 
@@ -151,10 +201,9 @@ void BlueFoxParameters::set_trigger_mode(mvIMPACT::acquire::TCameraTriggerMode t
 	}
 }
 
-void BlueFoxParameters::set_trigger_source(mvIMPACT::acquire::TCameraTriggerSource trigger_source)
+void BlueFoxParameters::apply_trigger_source(mvIMPACT::acquire::TCameraTriggerSource trigger_source)
 {
-	Acquisition_lock lock(package);//If the function modifies the parameters, always call the lock at the very beginning
-	if(!check_cam() || !lock.is_valid()) return;
+	if(!check_cam()) return;
 
 	mvIMPACT::acquire::CameraSettingsBlueFOX cam_settings(p_dev);
 	bool check_source = check_property<mvIMPACT::acquire::TCameraTriggerSource>(trigger_source, cam_settings.triggerSource);
@@ -166,20 +215,30 @@ void BlueFoxParameters::set_trigger_source(mvIMPACT::acquire::TCameraTriggerSour
 	}
 }
 
-void BlueFoxParameters::set_exposure_time(int exposure_time_us)
+void BlueFoxParameters::apply_exposure_time(int exposure_time_us)
 {
 	//The exposure time is in microseconds
-	Acquisition_lock lock(package);//If the function modifies the parameters, always call the lock at the very beginning
-	if(!check_cam() || !lock.is_valid()) return;
+	if(!check_cam()) return;
 
 	mvIMPACT::acquire::CameraSettingsBlueFOX cam_settings(p_dev);
 	cam_settings.expose_us.write(exposure_time_us);
 }
 
-void BlueFoxParameters::set_pixelclock(mvIMPACT::acquire::TCameraPixelClock pixelclock)
+void BlueFoxParameters::apply_gain(double gain_db)
 {
-	Acquisition_lock lock(package);//If the function modifies the parameters, always call the lock at the very beginning
-	if(!check_cam() || !lock.is_valid()) return;
+	if(!check_cam()) return;
+
+	mvIMPACT::acquire::CameraSettingsBlueFOX cam_settings(p_dev);
+	if(cam_settings.gain_dB.isValid()) cam_settings.gain_dB.write(gain_db);
+	else
+	{
+		std::cerr << "Warning : attempt to modify the gain, but the feature is not available." << std::endl;
+	}
+}
+
+void BlueFoxParameters::apply_pixelclock(mvIMPACT::acquire::TCameraPixelClock pixelclock)
+{
+	if(!check_cam()) return;
 
 	mvIMPACT::acquire::CameraSettingsBlueFOX cam_settings(p_dev);
 	if(cam_settings.pixelClock_KHz.isValid())
@@ -200,11 +259,10 @@ void BlueFoxParameters::set_pixelclock(mvIMPACT::acquire::TCameraPixelClock pixe
 	}
 }
 
-void BlueFoxParameters::set_request_timeout_ms(int timeout_ms)
+void BlueFoxParameters::apply_request_timeout_ms(int timeout_ms)
 {
 	//Timeout for an image request in milliseconds
-	Acquisition_lock lock(package);//If the function modifies the parameters, always call the lock at the very beginning
-	if(!check_cam() || !lock.is_valid()) return;
+	if(!check_cam()) return;
 
 	mvIMPACT::acquire::CameraSettingsBlueFOX cam_settings(p_dev);
 
@@ -299,7 +357,43 @@ int CamBlueFox::stop_acq()
     return 0;
 }
 
+int CamBlueFox::set_thread_policy(const Thread_policy& policy)
+{
+	//The threads of mvIMPACT are internal to the driver : the worker thread of the device (which handles the USB events)
+	//gets the highest priority of the driver when a real-time priority is requested, but it can not be pinned.
+	if(!opened) return -10;
+
+	int ret = 0;
+	if(policy.usb_events.cpu >= 0)
+	{
+		std::cerr << "Warning : the threads of the mvBlueFOX driver can not be pinned on a core." << std::endl;
+		ret = -1;
+	}
+
+	if(policy.usb_events.rt_priority > 0)
+	{
+		mvIMPACT::acquire::SystemSettings sys_settings(p_dev);
+		if(sys_settings.workerPriority.isValid() && check_property<mvIMPACT::acquire::TThreadPriority>(mvIMPACT::acquire::tpTimeCritical, sys_settings.workerPriority))
+		{
+			sys_settings.workerPriority.write(mvIMPACT::acquire::tpTimeCritical);
+		}
+		else
+		{
+			std::cerr << "Warning : the priority of the worker thread of the mvBlueFOX driver can not be set." << std::endl;
+			ret = -2;
+		}
+	}
+
+	return ret;
+}
+
 int CamBlueFox::retrieve_image(cv::Mat& image)
+{
+	Frame_info info;
+	return retrieve_frame(image, info);
+}
+
+int CamBlueFox::retrieve_frame(cv::Mat& image, Frame_info& info)
 {
 	//The model used here is to keep the request queue full, and to use an external trigger. This means that some of the requests can time out.
 	//For this reason, we always check the number of results, and discard them all except the last one.
@@ -330,6 +424,8 @@ int CamBlueFox::retrieve_image(cv::Mat& image)
 				mvIMPACT::acquire::ImageBuffer * p_ib = pRequest->getImageBufferDesc().getBuffer();
 				export_image(p_ib->iWidth, p_ib->iHeight, p_ib->vpData, params.get_pixel_format(), image);
 				//We have copied the image data a this point
+				info.host_tp = clock_type::now();
+				info.device_timestamp_us = pRequest->infoTimeStamp_us.read();
 				ret = 0;
 			}
 			//If the request is not ok, it is probably a timeout of the request, we silently discard it.
@@ -409,17 +505,18 @@ void CamBlueFox::init(const std::string& cam_id)
     opened = true;
     //Initialize the settings
     params.set_p_dev(p_dev);
-    //Settings for the acquisition
-    params.set_image_size(0, 0);//Max width and height
-    params.set_agc(agc_d);//Automatic gain control
-    params.set_aec(aec_d);//Automatic exposure control
-    params.set_trigger_mode(trigger_d);//Trigger mode
-    params.set_trigger_source(trigger_src_d);//Trigger source
-    params.set_exposure_time(exposure_us_d);//Exposure time
-    params.set_pixelclock(pixelclock_d);//Pixel clock
-    params.set_request_timeout_ms(image_request_timeout_ms_d);//image request timeout
+    //Settings for the acquisition, applied directly : the camera is being added and Acquisition::add_camera holds the camera vector,
+    //posting a command from here would take the mutexes of the acquisition in the opposite order to stop_acq
+    params.apply_image_size(0, 0);//Max width and height
+    params.apply_agc(agc_d);//Automatic gain control
+    params.apply_aec(aec_d);//Automatic exposure control
+    params.apply_trigger_mode(trigger_d);//Trigger mode
+    params.apply_trigger_source(trigger_src_d);//Trigger source
+    params.apply_exposure_time(exposure_us_d);//Exposure time
+    params.apply_pixelclock(pixelclock_d);//Pixel clock
+    params.apply_request_timeout_ms(image_request_timeout_ms_d);//image request timeout
     //Settings for the output
-    params.set_image_type(pixel_format_d);
+    params.apply_image_type(pixel_format_d);
 
     std::cout << "Camera (Serial " << p_dev->serial.read() << ") has been opened successfully." << std::endl;
     if(!clock_type::is_steady)
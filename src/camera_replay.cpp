@@ -0,0 +1,250 @@
+#include "camera_replay.hpp"
+
+#include "acquisition.hpp"
+
+#include "opencv2/core/version.hpp"
+#if CV_MAJOR_VERSION == 2
+#include <opencv2/highgui/highgui.hpp>
+#elif CV_MAJOR_VERSION == 3
+#include <opencv2/imgcodecs.hpp>
+#endif
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <iostream>
+
+namespace cam
+{
+
+template<>
+std::unique_ptr<Camera_seq> Camera_seq::get_instance<replay>(Cond_var_package& package, const std::string& session_path)
+{
+	return std::unique_ptr<CamReplay>(new CamReplay(package, session_path));
+}
+
+//ReplayParameters : Public functions
+//The parameters are read by load_session, so all the modifications restart the replay (the session is reloaded by start_acq)
+void ReplayParameters::set_camera_index(int camera_index_)
+{
+	post_command([this, camera_index_]{camera_index = camera_index_;}, false);
+}
+
+void ReplayParameters::set_pacing(Replay_pacing pacing_, double rate_hz_)
+{
+	post_command([this, pacing_, rate_hz_]{
+		pacing = pacing_;
+		if(rate_hz_ > 0) rate_hz = rate_hz_;
+	}, false);
+}
+
+void ReplayParameters::set_loop(bool loop_)
+{
+	post_command([this, loop_]{loop = loop_;}, false);
+}
+
+void ReplayParameters::set_preload(bool preload_)
+{
+	post_command([this, preload_]{preload = preload_;}, false);
+}
+
+//CamReplay : Public functions
+CamReplay::CamReplay(Cond_var_package& package_, const std::string& session_path_) : params(package_), session_path(session_path_), next_frame(0), first_timestamp(0), opened(false)
+{
+	struct stat path_stat;
+	if(stat(session_path.c_str(), &path_stat) != 0)
+	{
+		std::cerr << "Replay : " << session_path << " does not exist." << std::endl;
+		return;
+	}
+	opened = true;//The session itself is loaded at start, when the parameters are known
+}
+
+CamReplay::~CamReplay()
+{
+	stop_acq();
+}
+
+int CamReplay::start_acq(bool /*only_one_camera*/)
+{
+	if(!opened) return -10;
+
+	const int ret = load_session();
+	if(ret != 0) return ret;
+
+	next_frame = 0;
+	first_timestamp = frame_timestamp(0);
+	start_tp = clock_type::now();
+
+	return 0;
+}
+
+int CamReplay::stop_acq()
+{
+	return 0;
+}
+
+int CamReplay::retrieve_image(cv::Mat& image)
+{
+	Frame_info info;
+	return retrieve_frame(image, info);
+}
+
+int CamReplay::retrieve_frame(cv::Mat& image, Frame_info& info)
+{
+	if(!opened) return -10;
+
+	if(next_frame >= frame_count())
+	{
+		if(!params.get_loop() || frame_count() == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(replay_end_wait_ms));
+			return -3;
+		}
+		next_frame = 0;//Start the session again
+		start_tp = clock_type::now();
+	}
+
+	const size_t n = next_frame++;
+	wait_for_frame(n);
+
+	const int ret = read_frame(n, image);
+	info.device_timestamp_us = frame_timestamp(n);
+	info.host_tp = clock_type::now();
+
+	return ret;
+}
+
+//Private functions:
+int CamReplay::load_session()
+{
+	png_frames.clear();
+	preloaded.clear();
+	reader.reset();
+
+	const int camera_index = params.get_camera_index();
+
+	struct stat path_stat;
+	if(stat(session_path.c_str(), &path_stat) == 0 && S_ISDIR(path_stat.st_mode))
+	{
+		//Directory written by stereo_example. The images are numbered from 0, with at least 5 digits.
+		const std::string prefix = session_path + "/cam" + std::to_string(camera_index) + "_image";
+		auto image_name = [&prefix](unsigned int nb) -> std::string
+		{
+			std::string nb_s = std::to_string(nb);
+			if(nb_s.length() < 5) nb_s = std::string(5 - nb_s.length(), '0') + nb_s;
+			return prefix + nb_s + ".png";
+		};
+
+		std::ifstream csv(session_path + "/image_data.csv");
+		if(csv.is_open())
+		{
+			std::string line;
+			while(std::getline(csv, line))
+			{
+				std::istringstream line_stream(line);
+				unsigned int nb;
+				char separator;
+				int64_t timestamp;
+				if(line_stream >> nb >> separator >> timestamp) png_frames.push_back(Png_frame{image_name(nb), timestamp});
+			}
+		}
+		else
+		{
+			//No timestamps : take the images until the first missing one
+			for(unsigned int nb = 0; ; ++nb)
+			{
+				struct stat file_stat;
+				if(stat(image_name(nb).c_str(), &file_stat) != 0) break;
+				png_frames.push_back(Png_frame{image_name(nb), -1});
+			}
+		}
+
+		if(params.get_preload())
+		{
+			preloaded.resize(png_frames.size());
+			for(size_t i = 0; i < png_frames.size(); ++i)
+			{
+				preloaded[i] = cv::imread(png_frames[i].file_name, -1);//-1 : keep the depth and channels of the file
+			}
+		}
+	}
+	else
+	{
+		reader = std::unique_ptr<Recording_reader>(new Recording_reader(session_path));//Replace by make_unique in C++14
+		if(!reader->is_open())
+		{
+			reader.reset();
+			return -1;
+		}
+		//A recording is already mapped in memory, preloading is not needed
+	}
+
+	if(frame_count() == 0)
+	{
+		std::cerr << "Replay : no image found for camera " << camera_index << " in " << session_path << "." << std::endl;
+		return -2;
+	}
+
+	return 0;
+}
+
+size_t CamReplay::frame_count() const
+{
+	return reader ? reader->size() : png_frames.size();
+}
+
+int64_t CamReplay::frame_timestamp(size_t n) const
+{
+	if(reader) return reader->get_timestamp(n);
+	return n < png_frames.size() ? png_frames[n].timestamp : -1;
+}
+
+int CamReplay::read_frame(size_t n, cv::Mat& image)
+{
+	if(reader)
+	{
+		const size_t camera_index = params.get_camera_index();
+		if(reader->read(n, recorded_set) != 0 || camera_index >= recorded_set.images.size() || recorded_set.images[camera_index].empty())
+		{
+			return -1;//Damaged record, or the camera missed this set
+		}
+		recorded_set.images[camera_index].copyTo(image);//The recording is read-only, and the set must own its image
+		return 0;
+	}
+
+	if(!preloaded.empty())
+	{
+		if(preloaded[n].empty()) return -1;
+		preloaded[n].copyTo(image);
+		return 0;
+	}
+
+	cv::Mat decoded = cv::imread(png_frames[n].file_name, -1);
+	if(decoded.empty()) return -1;
+	cv::swap(decoded, image);
+	return 0;
+}
+
+void CamReplay::wait_for_frame(size_t n)
+{
+	const Replay_pacing pacing = params.get_pacing();
+	if(pacing == as_fast_as_possible) return;
+
+	const int64_t timestamp = frame_timestamp(n);
+	int64_t delay_us;
+	if(pacing == realtime && timestamp >= 0 && first_timestamp >= 0)
+	{
+		delay_us = timestamp - first_timestamp;
+	}
+	else
+	{
+		delay_us = static_cast<int64_t>(n * 1000000.0 / params.get_rate_hz());
+	}
+
+	std::this_thread::sleep_until(start_tp + std::chrono::microseconds(delay_us));
+}
+
+} //namespace cam
@@ -0,0 +1,207 @@
+#include "camera_synthetic.hpp"
+
+#include "acquisition.hpp"
+
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <algorithm>
+
+namespace cam
+{
+
+template<>
+std::unique_ptr<Camera_seq> Camera_seq::get_instance<synthetic>(Cond_var_package& package, const std::string& cam_id)
+{
+	return std::unique_ptr<CamSynthetic>(new CamSynthetic(package, cam_id));
+}
+
+//SyntheticParameters : Public functions
+void SyntheticParameters::set_image_format(int width_, int height_, int type_)
+{
+	if(width_ <= 0 || height_ <= 0) return;
+	post_command([this, width_, height_, type_]{width = width_; height = height_; type = type_;}, true);//The next image is created with the new format
+}
+
+void SyntheticParameters::set_rate(double rate_hz_)
+{
+	if(rate_hz_ <= 0) return;
+	post_command([this, rate_hz_]{rate_hz = rate_hz_;}, false);//Used by start_acq
+}
+
+void SyntheticParameters::set_latency(int64_t latency_us_, int64_t jitter_us_, Latency_distribution distribution_)
+{
+	latency_us_ = std::max<int64_t>(latency_us_, 0);
+	jitter_us_ = std::max<int64_t>(jitter_us_, 0);
+	post_command([this, latency_us_, jitter_us_, distribution_]{latency_us = latency_us_; jitter_us = jitter_us_; distribution = distribution_;}, true);
+}
+
+void SyntheticParameters::set_drop_probability(double probability)
+{
+	probability = std::min(std::max(probability, 0.0), 0.99);//At least some frames have to arrive
+	post_command([this, probability]{drop_probability = probability;}, true);
+}
+
+void SyntheticParameters::set_timeout_probability(double probability)
+{
+	probability = std::min(std::max(probability, 0.0), 1.0);
+	post_command([this, probability]{timeout_probability = probability;}, true);
+}
+
+void SyntheticParameters::set_clock_offset_us(int64_t offset_us)
+{
+	post_command([this, offset_us]{clock_offset_us = offset_us;}, true);
+}
+
+void SyntheticParameters::set_seed(uint64_t seed_)
+{
+	post_command([this, seed_]{seed = seed_;}, false);//Used by start_acq
+}
+
+void SyntheticParameters::set_trigger(const std::shared_ptr<Trigger_loopback>& trigger_)
+{
+	post_command([this, trigger_]{trigger = trigger_;}, false);//Used by start_acq
+}
+
+//CamSynthetic : Public functions
+CamSynthetic::CamSynthetic(Cond_var_package& package_, const std::string& cam_id) : params(package_, std::hash<std::string>()(cam_id)), period_us(0), next_frame(0), lost_frames(0), last_pulse(0)
+{}
+
+int CamSynthetic::start_acq(bool only_one_camera)
+{
+	generator.seed(params.get_seed());
+	period_us = static_cast<int64_t>(1000000.0 / params.get_rate_hz());
+	next_frame = 0;
+	lost_frames = 0;
+	start_tp = clock_type::now();
+
+	//As with the real cameras, a single camera runs freely even if it has a trigger
+	trigger = only_one_camera ? nullptr : params.get_trigger();
+	last_pulse = trigger ? trigger->get_pulse_count() : 0;//The pulses sent before the start are ignored
+
+	return 0;
+}
+
+int CamSynthetic::stop_acq()
+{
+	return 0;
+}
+
+int CamSynthetic::retrieve_image(cv::Mat& image)
+{
+	Frame_info info;
+	return retrieve_frame(image, info);
+}
+
+int CamSynthetic::retrieve_frame(cv::Mat& image, Frame_info& info)
+{
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+	if(uniform(generator) < params.get_timeout_probability())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(synthetic_timeout_ms));
+		return -1;
+	}
+
+	if(trigger) return retrieve_triggered_frame(image, info);
+
+	//If the caller is late, the frames which have been overwritten in the camera are lost
+	const int64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - start_tp).count();
+	const uint64_t latest_frame = elapsed_us > 0 ? static_cast<uint64_t>(elapsed_us / period_us) : 0;
+	if(latest_frame > next_frame + 1)
+	{
+		lost_frames += latest_frame - 1 - next_frame;
+		next_frame = latest_frame - 1;
+	}
+
+	while(uniform(generator) < params.get_drop_probability())
+	{
+		++next_frame;//Lost in the transfer
+		++lost_frames;
+	}
+
+	const uint64_t frame_nb = next_frame++;
+	const int64_t exposure_us = frame_nb * period_us;
+	std::this_thread::sleep_until(start_tp + std::chrono::microseconds(exposure_us + draw_latency_us()));
+	info.usb_tp = clock_type::now();//The image "arrives" after the simulated latency
+
+	fill_image(image, frame_nb);
+	info.device_timestamp_us = params.get_clock_offset_us() + exposure_us;
+	info.host_tp = clock_type::now();
+	info.decoded_tp = info.host_tp;
+
+	return 0;
+}
+
+//Private functions:
+int CamSynthetic::retrieve_triggered_frame(cv::Mat& image, Frame_info& info)
+{
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+	const uint64_t previous_pulse = last_pulse;
+	clock_type::time_point pulse_tp;
+	if(!trigger->wait_pulse(last_pulse, pulse_tp, synthetic_timeout_ms)) return -1;
+
+	while(uniform(generator) < params.get_drop_probability())
+	{
+		//Lost in the transfer, the camera waits for the next pulse
+		if(!trigger->wait_pulse(last_pulse, pulse_tp, synthetic_timeout_ms)) return -1;
+	}
+	lost_frames += last_pulse - previous_pulse - 1;//Pulses dropped or skipped because the caller was late
+
+	const uint64_t frame_nb = last_pulse;
+	std::this_thread::sleep_until(pulse_tp + std::chrono::microseconds(draw_latency_us()));
+	info.usb_tp = clock_type::now();
+
+	fill_image(image, frame_nb);
+	info.device_timestamp_us = params.get_clock_offset_us() + std::chrono::duration_cast<std::chrono::microseconds>(pulse_tp - start_tp).count();
+	info.host_tp = clock_type::now();
+	info.decoded_tp = info.host_tp;
+
+	return 0;
+}
+
+int64_t CamSynthetic::draw_latency_us()
+{
+	const double latency = params.get_latency_us();
+	const double jitter = params.get_jitter_us();
+	double value = latency;
+	if(jitter <= 0) return static_cast<int64_t>(latency);
+
+	switch(params.get_distribution())
+	{
+		case latency_uniform:
+		{
+			std::uniform_real_distribution<double> distribution(latency - jitter, latency + jitter);
+			value = distribution(generator);
+			break;
+		}
+		case latency_normal:
+		{
+			std::normal_distribution<double> distribution(latency, jitter);
+			value = distribution(generator);
+			break;
+		}
+		case latency_constant:
+		default:
+		break;
+	}
+
+	return value > 0 ? static_cast<int64_t>(value) : 0;
+}
+
+void CamSynthetic::fill_image(cv::Mat& image, uint64_t frame_nb) const
+{
+	image.create(params.get_height(), params.get_width(), params.get_type());//Does nothing if the buffer already has the right format
+
+	const size_t row_size = image.cols * image.elemSize();
+	const unsigned char value = static_cast<unsigned char>(frame_nb);
+	for(int r = 0; r < image.rows; ++r)
+	{
+		unsigned char * row = image.ptr(r);
+		std::memset(row, value, row_size);
+		std::memcpy(row, &frame_nb, std::min(row_size, sizeof(frame_nb)));
+	}
+}
+
+} //namespace cam
@@ -21,35 +21,50 @@ void CamTau2::callbackTauImage(TauRawBitmap& tauRawBitmap, void* caller)
     if(!ptr)
         return;
 
-    cv::Mat img = cv::Mat(tauRawBitmap.height,tauRawBitmap.width,CV_16U,tauRawBitmap.data)(ptr->params.get_image_roi());
-
-    switch(ptr->params.get_pixel_format()){
-        case CV_8U:
+    Frame_info info;
+    info.host_tp = clock_type::now();//Time of arrival of the decoded image
+    info.usb_tp = tauRawBitmap.usbTime;//Same clock as clock_type
+    info.decoded_tp = tauRawBitmap.decodedTime;
+    if(ptr->params.get_use_pps_timestamp())
+    {
+        //The counter gives the milliseconds since the last PPS edge, so it only tells the time modulo one second.
+        //The number of whole seconds since the previous frame is taken from the host clock : it is the one bringing the
+        //device time elapsed closest to the host time elapsed (a decrease of the counter alone would miss the seconds
+        //of a stalled or slowly triggered stream). The jitter of the arrival time has to stay below half a second.
+        if(ptr->last_pps_tp != clock_type::time_point())
         {
-            double m = 30.0/64.0;
-            double mean_img = cv::mean(img)[0];
-            img = img * m + (127-mean_img* m);
-            img.convertTo(img, CV_8U);
-            break;
+            const int64_t host_elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(info.host_tp - ptr->last_pps_tp).count();
+            const int64_t counter_elapsed_us = (static_cast<int64_t>(tauRawBitmap.pps_timestamp) - static_cast<int64_t>(ptr->last_pps))*1000;
+            const int64_t seconds = (host_elapsed_us - counter_elapsed_us + 500000) / 1000000;
+            if(seconds > 0) ptr->pps_base_us += seconds*1000000;
         }
-        case CV_16U:
-        // image already 16bit, nothing to do
-        break;
-        default:
-            std::cerr << "[Tau2] Error pixel format not recognised. please select 8U/16U" << std::endl;
-        break;
+        ptr->last_pps = tauRawBitmap.pps_timestamp;
+        ptr->last_pps_tp = info.host_tp;
+        info.device_timestamp_us = ptr->pps_base_us + static_cast<int64_t>(tauRawBitmap.pps_timestamp)*1000;
     }
 
+    //The bitmap is reused by the driver for the next frame : its data is written once in image_decoded (no allocation once
+    //the buffers have the right size), then the buffers are exchanged with the one given to retrieve_frame.
+    //The conversion to 8 bits is left to retrieve_frame, so it is only done for the images actually retrieved.
+    cv::Mat img = cv::Mat(tauRawBitmap.height,tauRawBitmap.width,CV_16U,tauRawBitmap.data);//Already cropped to the ROI by the decoder
+    img.copyTo(ptr->image_decoded);
 
     {
         std::lock_guard<std::mutex> lock(ptr->image_available_mutex);
-        img.copyTo(ptr->image_acquired);
+        cv::swap(ptr->image_decoded, ptr->image_acquired);
+        ptr->info_acquired = info;
         ptr->new_image_available = true;
         ptr->cv.notify_all();
     }
 }
 
 int CamTau2::retrieve_image(cv::Mat& image)
+{
+    Frame_info info;
+    return retrieve_frame(image, info);
+}
+
+int CamTau2::retrieve_frame(cv::Mat& image, Frame_info& info)
 {
 
     if(!opened)
@@ -60,28 +75,76 @@ int CamTau2::retrieve_image(cv::Mat& image)
     if(!success)
         return -1;
 
-    image_acquired.copyTo(image);
+    info = info_acquired;
     new_image_available = false;
 
+    if(params.get_pixel_format() != CV_8U)
+    {
+        //Exchange the buffers instead of copying : the previous buffer of the caller will receive the next image
+        cv::swap(image_acquired, image);
+        return 0;
+    }
+
+    //The 16 bits image is taken out of the shared buffer, so the callback is not blocked during the conversion
+    cv::swap(image_acquired, image_raw);
+    mlock.unlock();
+
+    tone_mapper.set_mode(params.get_tone_mapping());
+    tone_mapper.set_plateau(params.get_plateau());
+    tone_mapper.apply(image_raw, image);
+
     return 0;
 }
 
 void Tau2Parameters::set_pixel_format(int pixel_format_)
 {
-    pixel_format = pixel_format_;
+    if(pixel_format_ != CV_8U && pixel_format_ != CV_16U)
+    {
+        std::cerr << "[Tau2] Error pixel format not recognised. please select 8U/16U" << std::endl;
+        return;
+    }
+    post_command([this, pixel_format_]{pixel_format = pixel_format_;}, true);//Read by retrieve_frame for each image
+}
+
+void Tau2Parameters::set_tone_mapping(Tone_mapping tone_mapping_, double plateau_)
+{
+    if(plateau_ <= 0 || plateau_ > 1)
+    {
+        std::cerr << "[Tau2] Error the plateau has to be in ]0,1]" << std::endl;
+        return;
+    }
+    post_command([this, tone_mapping_, plateau_]{tone_mapping = tone_mapping_; plateau = plateau_;}, true);//Read by retrieve_frame for each image
 }
 
 void Tau2Parameters::set_image_roi(int startx_, int starty_,int width_,int height_)
 {
-    image_ROI = cv::Rect(startx_,starty_,width_,height_);
+    if(startx_ < 0 || starty_ < 0 || width_ < 0 || height_ < 0)
+    {
+        std::cerr << "[Tau2] Invalid ROI, the values must be positive" << std::endl;
+        return;
+    }
+    post_command([this, startx_, starty_, width_, height_]{
+        image_ROI = cv::Rect(startx_,starty_,width_,height_);
+        if(p_grab)
+            p_grab->setROI(startx_, starty_, width_, height_);//Taken by the decoder from the next frame
+    }, true);
+}
+
+void Tau2Parameters::set_use_pps_timestamp(bool use_pps_)
+{
+    post_command([this, use_pps_]{use_pps_timestamp.store(use_pps_);}, true);//Read by the USB callback, no need to stop the acquisition
 }
 
 void Tau2Parameters::set_trigger_mode(thermal_grabber::TriggerMode trigger_mode_)
 {
-    p_grab->setTriggerMode(trigger_mode_);
+    post_command([this, trigger_mode_]{
+        trigger_mode = trigger_mode_;//Applied again by start_acq
+        if(p_grab)
+            p_grab->setTriggerMode(trigger_mode_);
+    }, true);
 }
 
-CamTau2::CamTau2(Cond_var_package& package_, const std::string& cam_id_) : params(package_), new_image_available(false), opened(false)
+CamTau2::CamTau2(Cond_var_package& package_, const std::string& cam_id_) : params(package_), new_image_available(false), pps_base_us(0), last_pps(0), last_pps_tp(), opened(false)
 {
     init(cam_id_);
 }
@@ -91,7 +154,7 @@ CamTau2::~CamTau2()
     stop_acq();
 }
 
-int CamTau2::start_acq(bool only_one_camera)
+int CamTau2::start_acq(bool /*only_one_camera*/)
 {
 
     if(!opened)
@@ -99,18 +162,9 @@ int CamTau2::start_acq(bool only_one_camera)
         return -10;
     }
 
-    if(only_one_camera)
-    {
-        //set cam to continuous
-        p_grab->setTriggerMode(thermal_grabber::TriggerMode::disabled);
-        p_grab->doFFC();
-    }
-    else
-    {
-        //set cam to trigger mode (slave)
-        p_grab->setTriggerMode(thermal_grabber::TriggerMode::disabled);
-        p_grab->doFFC();
-    }
+    //The trigger mode is the one of the parameters (disabled by default : the camera runs continuously, also with other cameras)
+    p_grab->setTriggerMode(params.get_trigger_mode());
+    p_grab->doFFC();
 
     return 0;
 }
@@ -121,22 +175,35 @@ int CamTau2::stop_acq()
     return 0;
 }
 
+int CamTau2::set_thread_policy(const Thread_policy& policy)
+{
+    if(!opened)
+    {
+        return -10;
+    }
+
+    thermal_grabber::ThreadConfig usb_events;
+    usb_events.cpu = policy.usb_events.cpu;
+    usb_events.rtPriority = policy.usb_events.rt_priority;
+
+    thermal_grabber::ThreadConfig decoder;
+    decoder.cpu = policy.decoder.cpu;
+    decoder.rtPriority = policy.decoder.rt_priority;
+
+    return p_grab->setThreadConfig(usb_events, decoder) ? 0 : -1;
+}
+
 
 
 void CamTau2::init(const std::string& cam_id)
 {
 
-    if(cam_id.empty())
-    {
-        p_grab = std::unique_ptr<ThermalGrabber>(new ThermalGrabber(callbackTauImage, this));
-    }
-    else
-    {
-        p_grab = std::unique_ptr<ThermalGrabber>(new ThermalGrabber(callbackTauImage, this,cam_id.c_str()));
-    }
-
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    //The USB transfers are sized from the data rate (fewer wake-ups of the USB thread than with small fixed transfers)
+    thermal_grabber::StreamOptions stream_options;
+    stream_options.adaptive = true;
+    p_grab = std::unique_ptr<ThermalGrabber>(new ThermalGrabber(callbackTauImage, this, cam_id.c_str(), stream_options));//Empty id : first camera found
 
+    //The constructor returns once the core has replied to the configuration requests, no need to wait
     opened = p_grab->is_opened();
     if(!opened)
     {
@@ -147,6 +214,10 @@ void CamTau2::init(const std::string& cam_id)
 
     std::cout << "[Tau2] Camera " << p_grab->getCameraSerialNumber() << " has been opened successfully" << std::endl;
 
+    params.setThermalGrabber(p_grab.get());
+    const cv::Rect roi = params.get_image_roi();
+    p_grab->setROI(roi.x, roi.y, roi.width, roi.height);//Give the ROI to the driver (not through set_image_roi : add_camera holds the camera vector, see Camera_params::post_command)
+
     if(!clock_type::is_steady)
     {
         std::cerr << "Warning : non steady clock type, timer might go back in time." << std::endl;
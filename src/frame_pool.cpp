@@ -0,0 +1,65 @@
+#include "frame_pool.hpp"
+
+namespace cam {
+
+Frame_pool::Frame_pool() : state(std::make_shared<Pool_state>())
+{}
+
+std::shared_ptr<Frame_set> Frame_pool::acquire(size_t cam_number)
+{
+	std::unique_ptr<Frame_set> set;
+
+	{//Mutex scope
+		std::lock_guard<std::mutex> lock(state->mtx);
+		if(!state->free_sets.empty())
+		{
+			set = std::move(state->free_sets.back());
+			state->free_sets.pop_back();
+		}
+		else
+		{
+			++state->allocated;
+		}
+	}
+
+	if(!set) set = std::unique_ptr<Frame_set>(new Frame_set());//Replace by make_unique in C++14
+
+	set->images.resize(cam_number);
+	set->frame_info.assign(cam_number, Frame_info());
+	set->timestamp = 0;
+	set->seq = 0;
+	for(cv::Mat& img : set->images)
+	{
+		//If a consumer kept a header on this buffer after releasing the set, do not overwrite its data
+		if(is_shared(img)) img.release();
+	}
+
+	return std::shared_ptr<Frame_set>(set.release(), Recycler{state});
+}
+
+size_t Frame_pool::allocated() const
+{
+	std::lock_guard<std::mutex> lock(state->mtx);
+	return state->allocated;
+}
+
+void Frame_pool::Recycler::operator()(Frame_set * set) const
+{
+	std::unique_ptr<Frame_set> set_ptr(set);
+	std::shared_ptr<Pool_state> pool = state.lock();
+	if(!pool) return;//The pool has been destroyed, the set is simply deleted
+
+	std::lock_guard<std::mutex> lock(pool->mtx);
+	pool->free_sets.push_back(std::move(set_ptr));
+}
+
+bool Frame_pool::is_shared(const cv::Mat& img)
+{
+	#if CV_MAJOR_VERSION == 2
+	return img.refcount && *img.refcount > 1;
+	#else
+	return img.u && img.u->refcount > 1;
+	#endif
+}
+
+} //namespace cam
@@ -0,0 +1,130 @@
+#include "frame_ring.hpp"
+
+#include <chrono>
+
+namespace cam {
+
+Frame_ring::Frame_ring(size_t depth, Overflow_policy policy)
+				: slots(depth > 0 ? depth : 1)
+				, overflow_policy(policy)
+				, head(0)
+				, tail(0)
+				, pushed_count(0)
+				, dropped_count(0)
+				, consumers_waiting(0)
+				, producer_waiting(false)
+{}
+
+bool Frame_ring::push(const Frame_set_ptr& frame_set, int timeout_ms)
+{
+	const uint64_t h = head.load();
+	const uint64_t ring_size = slots.size();
+
+	if(overflow_policy == overwrite_oldest)
+	{
+		//Make room by moving the tail forward. If a consumer takes the oldest set at the same time, the exchange fails and we check again.
+		uint64_t t = tail.load();
+		while(h - t >= ring_size)
+		{
+			if(tail.compare_exchange_weak(t, t + 1))
+			{
+				dropped_count.fetch_add(1);
+				break;
+			}
+		}
+	}
+	else if(!has_space())
+	{
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+		producer_waiting.store(true);
+		{//Mutex scope
+			std::unique_lock<std::mutex> mlock(wait_mtx);
+			space_cv.wait_until(mlock, deadline, [this]{return has_space();});
+		}
+		producer_waiting.store(false);
+
+		if(!has_space())
+		{
+			dropped_count.fetch_add(1);
+			return false;
+		}
+	}
+
+	std::atomic_store(&slots[h % ring_size], frame_set);
+	head.store(h + 1);//Publish the set
+	pushed_count.fetch_add(1);
+
+	if(consumers_waiting.load() > 0)
+	{
+		//Taking the mutex guarantees that a consumer which has just checked the ring is either not asleep yet (it will see the set) or already waiting
+		{std::lock_guard<std::mutex> mlock(wait_mtx);}
+		data_cv.notify_all();
+	}
+
+	return true;
+}
+
+bool Frame_ring::try_pop(Frame_set_ptr& frame_set)
+{
+	const uint64_t ring_size = slots.size();
+	uint64_t t = tail.load();
+	while(t < head.load())
+	{
+		Frame_set_ptr& slot = slots[t % ring_size];
+		Frame_set_ptr candidate = std::atomic_load(&slot);
+		//If the producer overwrote this slot, it moved the tail before doing so, and the exchange fails
+		if(tail.compare_exchange_strong(t, t + 1))
+		{
+			//Empty the slot so that it does not keep the set out of the pool. Once the tail has moved, the producer may already
+			//have written a new set in this slot : it is only emptied if it still holds the set popped.
+			Frame_set_ptr expected = candidate;
+			std::atomic_compare_exchange_strong(&slot, &expected, Frame_set_ptr());
+			frame_set = std::move(candidate);
+
+			if(producer_waiting.load())
+			{
+				{std::lock_guard<std::mutex> mlock(wait_mtx);}
+				space_cv.notify_one();
+			}
+			return true;
+		}
+		//t has been updated with the current tail, try again
+	}
+	return false;
+}
+
+bool Frame_ring::pop(Frame_set_ptr& frame_set, int timeout_ms)
+{
+	if(try_pop(frame_set)) return true;
+
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+	bool success = false;
+
+	consumers_waiting.fetch_add(1);
+	while(!success)
+	{
+		{//Mutex scope
+			std::unique_lock<std::mutex> mlock(wait_mtx);
+			if(!data_cv.wait_until(mlock, deadline, [this]{return has_data();})) break;//Timeout
+		}
+		success = try_pop(frame_set);//Another consumer may have been faster, in which case we wait again
+	}
+	consumers_waiting.fetch_sub(1);
+
+	return success;
+}
+
+void Frame_ring::clear()
+{
+	Frame_set_ptr frame_set;
+	while(try_pop(frame_set)) {}
+}
+
+size_t Frame_ring::size() const
+{
+	const uint64_t t = tail.load();
+	const uint64_t h = head.load();
+	return h > t ? static_cast<size_t>(h - t) : 0;
+}
+
+} //namespace cam
@@ -0,0 +1,134 @@
+#include "frame_synchronizer.hpp"
+
+#include <algorithm>
+
+namespace cam {
+
+Frame_synchronizer::Frame_synchronizer(size_t cam_number, int64_t tolerance_us_, Straggler_policy policy_, int64_t max_wait_us_)
+				: tolerance_us(tolerance_us_)
+				, policy(policy_)
+				, max_wait_us(max_wait_us_)
+				, queues(cam_number)
+				, dropped_frames(0)
+				, padded_sets(0)
+{}
+
+void Frame_synchronizer::push(size_t cam_idx, cv::Mat& image, const Frame_info& info)
+{
+	if(cam_idx >= queues.size()) return;
+	Camera_queue& queue = queues[cam_idx];
+
+	if(queue.entries.size() >= sync_queue_depth)
+	{
+		discard_front(cam_idx);//The other cameras stopped sending images, do not accumulate
+	}
+
+	queue.entries.push_back(Entry());
+	Entry& entry = queue.entries.back();
+	if(!queue.spare_images.empty())
+	{
+		entry.image = queue.spare_images.back();
+		queue.spare_images.pop_back();
+	}
+	cv::swap(entry.image, image);//The caller gets the spare buffer (or an empty image)
+	entry.info = info;
+	entry.aligned_tp = align(queue, info);
+}
+
+bool Frame_synchronizer::pop_set(Frame_set& frame_set, clock_type::time_point& set_tp, const clock_type::time_point& now)
+{
+	const size_t cam_number = queues.size();
+
+	while(true)
+	{
+		//The reference is the oldest image waiting
+		bool found = false;
+		clock_type::time_point ref_tp;
+		for(const Camera_queue& queue : queues)
+		{
+			if(!queue.entries.empty() && (!found || queue.entries.front().aligned_tp < ref_tp))
+			{
+				ref_tp = queue.entries.front().aligned_tp;
+				found = true;
+			}
+		}
+		if(!found) return false;
+
+		const clock_type::time_point window_end = ref_tp + std::chrono::microseconds(tolerance_us);
+		const bool timed_out = std::chrono::duration_cast<std::chrono::microseconds>(now - ref_tp).count() > max_wait_us;
+
+		bool complete = true;//All the cameras have an image in the window
+		bool decided = true;//For each missing camera, we know that the image will not come
+		for(const Camera_queue& queue : queues)
+		{
+			if(queue.entries.empty())
+			{
+				complete = false;
+				decided = decided && timed_out;//The image might still arrive
+			}
+			else if(queue.entries.front().aligned_tp > window_end)
+			{
+				complete = false;//The camera already sent a more recent image : it skipped this one
+			}
+		}
+
+		if(!complete && !decided) return false;//Wait for more images
+
+		if(!complete && policy == drop_incomplete)
+		{
+			for(size_t i = 0; i < cam_number; ++i)
+			{
+				if(!queues[i].entries.empty() && queues[i].entries.front().aligned_tp <= window_end) discard_front(i);
+			}
+			continue;//Try with the next images
+		}
+
+		//Build the set, missing images are left empty
+		frame_set.images.resize(cam_number);
+		frame_set.frame_info.assign(cam_number, Frame_info());
+		for(size_t i = 0; i < cam_number; ++i)
+		{
+			Camera_queue& queue = queues[i];
+			if(!queue.entries.empty() && queue.entries.front().aligned_tp <= window_end)
+			{
+				Entry& entry = queue.entries.front();
+				cv::swap(frame_set.images[i], entry.image);
+				frame_set.frame_info[i] = entry.info;
+				if(!entry.image.empty() && queue.spare_images.size() < sync_queue_depth) queue.spare_images.push_back(entry.image);//Previous buffer of the set, reused for the next images
+				queue.entries.pop_front();
+			}
+			else
+			{
+				frame_set.images[i].release();
+			}
+		}
+		if(!complete) ++padded_sets;
+
+		set_tp = ref_tp;
+		return true;
+	}
+}
+
+clock_type::time_point Frame_synchronizer::align(Camera_queue& queue, const Frame_info& info)
+{
+	if(info.device_timestamp_us < 0) return info.host_tp;//No camera clock, use the arrival time
+
+	const int64_t host_us = std::chrono::duration_cast<std::chrono::microseconds>(info.host_tp.time_since_epoch()).count();
+	queue.offsets_us.push_back(host_us - info.device_timestamp_us);
+	if(queue.offsets_us.size() > sync_offset_window) queue.offsets_us.pop_front();
+
+	const int64_t offset_us = *std::min_element(queue.offsets_us.begin(), queue.offsets_us.end());
+	return clock_type::time_point(std::chrono::duration_cast<clock_type::duration>(std::chrono::microseconds(info.device_timestamp_us + offset_us)));
+}
+
+void Frame_synchronizer::discard_front(size_t cam_idx)
+{
+	Camera_queue& queue = queues[cam_idx];
+	if(queue.entries.empty()) return;
+
+	if(!queue.entries.front().image.empty() && queue.spare_images.size() < sync_queue_depth) queue.spare_images.push_back(queue.entries.front().image);
+	queue.entries.pop_front();
+	++dropped_frames;
+}
+
+} //namespace cam
@@ -0,0 +1,146 @@
+#include "latency_stats.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace cam {
+
+namespace {
+
+int bucket_index(int64_t duration_us)
+{
+	int index = 0;
+	for(uint64_t value = static_cast<uint64_t>(duration_us); value > 0 && index < latency_bucket_number - 1; value >>= 1) ++index;
+	return index;
+}
+
+int64_t bucket_upper_bound_us(int index)
+{
+	return static_cast<int64_t>(1) << index;
+}
+
+} //namespace
+
+//Latency_histogram : public functions
+Latency_histogram::Latency_histogram()
+{
+	reset();
+}
+
+void Latency_histogram::record(int64_t duration_us)
+{
+	if(duration_us < 0) return;
+
+	buckets[bucket_index(duration_us)].fetch_add(1, std::memory_order_relaxed);
+	sum_us.fetch_add(static_cast<uint64_t>(duration_us), std::memory_order_relaxed);
+
+	int64_t current_max = max_us.load(std::memory_order_relaxed);
+	while(duration_us > current_max && !max_us.compare_exchange_weak(current_max, duration_us, std::memory_order_relaxed)) {}
+}
+
+Latency_summary Latency_histogram::summary() const
+{
+	Latency_summary result;
+	for(int k = 0; k < latency_bucket_number; ++k)
+	{
+		result.buckets[k] = buckets[k].load(std::memory_order_relaxed);
+		result.count += result.buckets[k];
+	}
+	if(result.count == 0) return result;
+
+	result.mean_us = static_cast<double>(sum_us.load(std::memory_order_relaxed)) / result.count;
+	result.max_us = max_us.load(std::memory_order_relaxed);
+
+	//Percentiles from the cumulated buckets
+	const uint64_t p50_rank = (result.count * 50 + 99) / 100;
+	const uint64_t p90_rank = (result.count * 90 + 99) / 100;
+	const uint64_t p99_rank = (result.count * 99 + 99) / 100;
+	uint64_t cumulated = 0;
+	for(int k = 0; k < latency_bucket_number; ++k)
+	{
+		const uint64_t previous = cumulated;
+		cumulated += result.buckets[k];
+		const int64_t bound = std::min(bucket_upper_bound_us(k), result.max_us);
+		if(previous < p50_rank && cumulated >= p50_rank) result.p50_us = bound;
+		if(previous < p90_rank && cumulated >= p90_rank) result.p90_us = bound;
+		if(previous < p99_rank && cumulated >= p99_rank) result.p99_us = bound;
+	}
+	return result;
+}
+
+void Latency_histogram::reset()
+{
+	for(std::atomic<uint64_t>& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+	sum_us.store(0, std::memory_order_relaxed);
+	max_us.store(0, std::memory_order_relaxed);
+}
+
+//Latency_stats : public functions
+void Latency_stats::record(Latency_stage stage, const clock_type::time_point& begin, const clock_type::time_point& end)
+{
+	if(begin == clock_type::time_point() || end < begin) return;
+
+	histograms[stage].record(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count());
+}
+
+void Latency_stats::record_frame(const Frame_info& info)
+{
+	const clock_type::time_point Frame_info::* const stages[] = {&Frame_info::usb_tp, &Frame_info::decoded_tp, &Frame_info::retrieved_tp};
+	const Latency_stage stage_ids[] = {stage_usb_arrival, stage_decoded, stage_retrieved};
+
+	clock_type::time_point previous = info.trigger_tp;
+	for(int s = 0; s < 3; ++s)
+	{
+		const clock_type::time_point& current = info.*stages[s];
+		if(current == clock_type::time_point()) continue;//Not provided by the camera
+
+		record(stage_ids[s], previous, current);
+		previous = current;
+	}
+}
+
+Latency_summary Latency_stats::summary(Latency_stage stage) const
+{
+	return histograms[stage].summary();
+}
+
+void Latency_stats::reset()
+{
+	for(Latency_histogram& histogram : histograms) histogram.reset();
+}
+
+void Latency_stats::print(std::ostream& stream) const
+{
+	//Formatted in a local stream, so that the flags of the caller's stream are not modified
+	std::ostringstream lines;
+	for(int s = 0; s < latency_stage_number; ++s)
+	{
+		const Latency_stage stage = static_cast<Latency_stage>(s);
+		const Latency_summary stats = summary(stage);
+		lines << std::left << std::setw(12) << stage_name(stage) << std::right << " : " << stats.count << " samples";
+		if(stats.count > 0)
+		{
+			lines << std::fixed << std::setprecision(1) << ", mean " << stats.mean_us << " us, p50 <= " << stats.p50_us << " us, p90 <= " << stats.p90_us
+				  << " us, p99 <= " << stats.p99_us << " us, max " << stats.max_us << " us";
+		}
+		lines << '\n';
+	}
+	stream << lines.str() << std::flush;
+}
+
+const char* Latency_stats::stage_name(Latency_stage stage)
+{
+	switch(stage)
+	{
+		case stage_trigger: return "trigger";
+		case stage_usb_arrival: return "usb_arrival";
+		case stage_decoded: return "decoded";
+		case stage_retrieved: return "retrieved";
+		case stage_published: return "published";
+		case stage_consumed: return "consumed";
+		default: return "unknown";
+	}
+}
+
+} //namespace cam
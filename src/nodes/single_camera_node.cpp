@@ -4,6 +4,8 @@
 
 #include "camera_mvbluefox.hpp"
 #include "camera_tau2.hpp"
+#include "camera_replay.hpp"
+#include "camera_synthetic.hpp"
 
 #include <opencv2/core/version.hpp>
 #if CV_MAJOR_VERSION == 2
@@ -101,7 +103,17 @@ int main(int argc, char * argv[])
 	}
 	#endif
 
-	std::vector<cv::Mat> img_vec;//Vector to store the images
+	if(cam_type == "replay"){
+		//cam_serial is the path of the recorded session
+		acq.add_camera<cam::replay>(cam_serial);
+	}
+
+	if(cam_type == "synthetic"){
+		acq.add_camera<cam::synthetic>(cam_serial);
+		img_encoding = get_encoding(dynamic_cast<cam::SyntheticParameters&>(acq.get_cam_params(0)).get_type());
+	}
+
+	cam::Frame_set_ptr frame_set;//Set of images shared with the acquisition (no copy)
 
 	sensor_msgs::ImagePtr msg;
 
@@ -109,10 +121,11 @@ int main(int argc, char * argv[])
 
 	while(sig_handle.check_term_sig() && acq.is_running())
 	{
-		int64_t ret_acq = acq.get_images(img_vec);
+		int64_t ret_acq = acq.get_frames(frame_set);
 		if(ret_acq > 0)
 		{
-			msg = cv_bridge::CvImage(std_msgs::Header(), img_encoding, img_vec[0]).toImageMsg();
+			const std::string encoding = img_encoding.empty() ? get_encoding(frame_set->images[0].type()) : img_encoding;//The replay gives the type of the recorded images
+			msg = cv_bridge::CvImage(std_msgs::Header(), encoding, frame_set->images[0]).toImageMsg();
 			pub.publish(msg);
 		}
 
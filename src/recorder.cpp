@@ -0,0 +1,300 @@
+#include "recorder.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+
+namespace cam {
+
+static constexpr int writer_poll_ms = 100;//Time after which the writer thread checks if it should stop
+
+Recorder::Recorder(const std::string& file_name_, bool direct_io_, size_t queue_depth, size_t batch_size)
+				: queue(queue_depth, block_producer)
+				, fd(-1)
+				, direct_io(direct_io_)
+				, file_name(file_name_)
+				, index_file(nullptr)
+				, buffer(nullptr)
+				, buffer_size(std::max(recorder_block_size, (batch_size + recorder_block_size - 1) / recorder_block_size * recorder_block_size))
+				, buffer_fill(0)
+				, file_size(0)
+				, should_run(true)
+				, written_sets(0)
+				, written_bytes(0)
+				, write_error(false)
+{
+	void * ptr = nullptr;
+	if(posix_memalign(&ptr, recorder_block_size, buffer_size) != 0)
+	{
+		std::cerr << "Recorder : cannot allocate the write buffer." << std::endl;
+		return;
+	}
+	buffer = static_cast<unsigned char*>(ptr);
+
+	const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+	#ifdef O_DIRECT
+	if(direct_io)
+	{
+		fd = ::open(file_name.c_str(), flags | O_DIRECT, 0644);
+		if(fd < 0)
+		{
+			std::cerr << "Recorder : O_DIRECT is not available for " << file_name << " (" << std::strerror(errno) << "), using buffered writes." << std::endl;
+		}
+	}
+	#endif
+	if(fd < 0)
+	{
+		direct_io = false;
+		fd = ::open(file_name.c_str(), flags, 0644);
+	}
+	if(fd < 0)
+	{
+		std::cerr << "Recorder : cannot open " << file_name << " (" << std::strerror(errno) << ")." << std::endl;
+		return;
+	}
+
+	rec::File_header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, rec::file_magic, sizeof(header.magic));
+	header.version = rec::format_version;
+	header.header_size = sizeof(header);
+	append(&header, sizeof(header));
+
+	index_file = std::fopen((file_name + rec::index_suffix).c_str(), "wb");
+	if(index_file)
+	{
+		rec::Index_header index_header;
+		std::memset(&index_header, 0, sizeof(index_header));
+		std::memcpy(index_header.magic, rec::index_magic, sizeof(index_header.magic));
+		index_header.version = rec::format_version;
+		index_header.entry_size = sizeof(rec::Index_entry);
+		std::fwrite(&index_header, sizeof(index_header), 1, index_file);
+	}
+	else
+	{
+		std::cerr << "Recorder : cannot create the index of " << file_name << ", the reader will rebuild it." << std::endl;
+	}
+
+	writer_thd = std::thread(&Recorder::thread_func, this);
+}
+
+Recorder::~Recorder()
+{
+	close();
+	std::free(buffer);
+}
+
+bool Recorder::record(const Frame_set_ptr& frame_set)
+{
+	if(!is_open() || !frame_set) return false;
+	return queue.push(frame_set, 0);//The set is dropped if the writer is late
+}
+
+void Recorder::close()
+{
+	if(writer_thd.joinable())
+	{
+		should_run.store(false);
+		writer_thd.join();//The thread writes the queued sets before stopping
+	}
+
+	if(fd >= 0)
+	{
+		::close(fd);
+		fd = -1;
+	}
+
+	if(index_file)
+	{
+		std::fclose(index_file);
+		index_file = nullptr;
+	}
+}
+
+void Recorder::thread_func()
+{
+	Frame_set_ptr frame_set;
+	while(true)
+	{
+		if(queue.pop(frame_set, writer_poll_ms))
+		{
+			const bool written = write_set(*frame_set);
+			frame_set.reset();//Give the buffers back to the pool as soon as possible
+			if(written) written_sets.fetch_add(1);
+		}
+		else if(!should_run.load())
+		{
+			break;
+		}
+	}
+
+	finish();
+}
+
+bool Recorder::write_set(const Frame_set& frame_set)
+{
+	if(write_error.load()) return false;//Nothing is written after an error
+
+	const size_t cam_number = frame_set.images.size();
+	const size_t headers_size = sizeof(rec::Record_header) + cam_number * sizeof(rec::Image_header);
+
+	image_headers.resize(cam_number);
+	uint64_t offset = rec::align_size(headers_size);
+	for(size_t i = 0; i < cam_number; ++i)
+	{
+		const cv::Mat& img = frame_set.images[i];
+		rec::Image_header& header = image_headers[i];
+		std::memset(&header, 0, sizeof(header));
+
+		header.rows = img.rows;
+		header.cols = img.cols;
+		header.type = img.type();
+		header.cam_index = i;
+		header.step = img.empty() ? 0 : img.cols * img.elemSize();
+		header.data_size = header.step * img.rows;
+		header.data_offset = offset;
+		header.device_timestamp_us = -1;
+		if(i < frame_set.frame_info.size())
+		{
+			const Frame_info& info = frame_set.frame_info[i];
+			header.device_timestamp_us = info.device_timestamp_us;
+			header.host_timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(info.host_tp.time_since_epoch()).count();
+		}
+		offset += rec::align_size(header.data_size);
+	}
+
+	rec::Index_entry entry;
+	entry.offset = file_size;
+	entry.timestamp = frame_set.timestamp;
+	entry.seq = frame_set.seq;
+	entry.cam_number = cam_number;
+	entry.cam_mask = 0;
+	for(size_t i = 0; i < cam_number && i < 32; ++i)
+	{
+		if(image_headers[i].data_size > 0) entry.cam_mask |= 1u << i;
+	}
+	if(index_file) std::fwrite(&entry, sizeof(entry), 1, index_file);
+
+	rec::Record_header record;
+	std::memset(&record, 0, sizeof(record));
+	record.magic = rec::record_magic;
+	record.cam_number = cam_number;
+	record.seq = frame_set.seq;
+	record.timestamp = frame_set.timestamp;
+	record.record_size = offset;
+
+	append(&record, sizeof(record));
+	append(image_headers.data(), cam_number * sizeof(rec::Image_header));
+	append_padding(rec::align_size(headers_size) - headers_size);
+
+	for(size_t i = 0; i < cam_number; ++i)
+	{
+		const cv::Mat& img = frame_set.images[i];
+		const rec::Image_header& header = image_headers[i];
+		if(header.data_size == 0) continue;
+
+		if(img.isContinuous())
+		{
+			append(img.data, header.data_size);
+		}
+		else
+		{
+			for(int r = 0; r < img.rows; ++r)
+			{
+				append(img.ptr(r), header.step);
+			}
+		}
+		append_padding(rec::align_size(header.data_size) - header.data_size);
+	}
+	return !write_error.load();
+}
+
+void Recorder::append(const void * data, size_t size)
+{
+	const unsigned char * src = static_cast<const unsigned char*>(data);
+	while(size > 0)
+	{
+		const size_t n = std::min(size, buffer_size - buffer_fill);
+		std::memcpy(buffer + buffer_fill, src, n);
+		buffer_fill += n;
+		file_size += n;
+		src += n;
+		size -= n;
+
+		if(buffer_fill == buffer_size)
+		{
+			flush_buffer(buffer_size);
+			buffer_fill = 0;
+		}
+	}
+}
+
+void Recorder::append_padding(size_t size)
+{
+	while(size > 0)
+	{
+		const size_t n = std::min(size, buffer_size - buffer_fill);
+		std::memset(buffer + buffer_fill, 0, n);
+		buffer_fill += n;
+		file_size += n;
+		size -= n;
+
+		if(buffer_fill == buffer_size)
+		{
+			flush_buffer(buffer_size);
+			buffer_fill = 0;
+		}
+	}
+}
+
+void Recorder::flush_buffer(size_t size)
+{
+	if(write_error.load()) return;//Do not write a file with a hole in it
+
+	size_t done = 0;
+	while(done < size)
+	{
+		const ssize_t ret = ::write(fd, buffer + done, size - done);
+		if(ret < 0)
+		{
+			if(errno == EINTR) continue;
+			std::cerr << "Recorder : error while writing " << file_name << " (" << std::strerror(errno) << "), the recording is stopped." << std::endl;
+			write_error.store(true);
+			return;
+		}
+		done += ret;
+	}
+	written_bytes.fetch_add(size);
+}
+
+void Recorder::finish()
+{
+	if(buffer_fill == 0) return;
+
+	size_t size = buffer_fill;
+	if(direct_io)
+	{
+		//O_DIRECT only accepts whole blocks : write a padded block, then cut the file to its real size
+		size = (buffer_fill + recorder_block_size - 1) / recorder_block_size * recorder_block_size;
+		std::memset(buffer + buffer_fill, 0, size - buffer_fill);
+	}
+	flush_buffer(size);
+	buffer_fill = 0;
+
+	if(direct_io && !write_error.load())
+	{
+		if(ftruncate(fd, file_size) != 0)
+		{
+			std::cerr << "Recorder : cannot set the size of " << file_name << " (" << std::strerror(errno) << ")." << std::endl;
+		}
+		written_bytes.store(file_size);
+	}
+}
+
+} //namespace cam
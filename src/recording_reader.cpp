@@ -0,0 +1,207 @@
+#include "recording_reader.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+
+namespace cam {
+
+namespace {
+
+//True if the image described by the header lies within its data (the header may come from a damaged or truncated file)
+bool image_fits(const rec::Image_header& header)
+{
+	if(header.rows <= 0 || header.cols <= 0 || header.type < 0 || header.type >= (CV_CN_MAX << CV_CN_SHIFT)) return false;
+	const uint64_t row_size = static_cast<uint64_t>(header.cols) * CV_ELEM_SIZE(header.type);
+	return header.step >= row_size && header.step <= header.data_size && static_cast<uint64_t>(header.rows) <= header.data_size / header.step;
+}
+
+} //namespace
+
+Recording_reader::Recording_reader(const std::string& file_name)
+				: data(nullptr)
+				, data_size(0)
+				, index_data(nullptr)
+				, index_size(0)
+				, entries(nullptr)
+				, entry_count(0)
+{
+	data = map_file(file_name, data_size);
+	if(!data)
+	{
+		std::cerr << "Recording_reader : cannot open " << file_name << "." << std::endl;
+		return;
+	}
+
+	const rec::File_header * header = reinterpret_cast<const rec::File_header*>(data);
+	if(data_size < sizeof(rec::File_header) || std::memcmp(header->magic, rec::file_magic, sizeof(header->magic)) != 0 || header->version != rec::format_version)
+	{
+		std::cerr << "Recording_reader : " << file_name << " is not a recording." << std::endl;
+		munmap(const_cast<unsigned char*>(data), data_size);
+		data = nullptr;
+		return;
+	}
+
+	if(!load_index(file_name + rec::index_suffix))
+	{
+		rebuild_index();
+	}
+}
+
+Recording_reader::~Recording_reader()
+{
+	if(data) munmap(const_cast<unsigned char*>(data), data_size);
+	if(index_data) munmap(const_cast<unsigned char*>(index_data), index_size);
+}
+
+int Recording_reader::read(size_t n, Frame_set& frame_set) const
+{
+	if(n >= entry_count) return -1;
+
+	const uint64_t offset = entries[n].offset;
+	if(offset > data_size - sizeof(rec::Record_header)) return -2;//data_size is at least the size of the file header
+
+	const rec::Record_header * record = reinterpret_cast<const rec::Record_header*>(data + offset);
+	if(record->magic != rec::record_magic || record->record_size > data_size - offset) return -2;
+
+	const size_t cam_number = record->cam_number;
+	if(sizeof(rec::Record_header) + cam_number * sizeof(rec::Image_header) > record->record_size) return -2;
+	const rec::Image_header * headers = reinterpret_cast<const rec::Image_header*>(record + 1);
+
+	frame_set.images.resize(cam_number);
+	frame_set.frame_info.resize(cam_number);
+	for(size_t i = 0; i < cam_number; ++i)
+	{
+		const rec::Image_header& header = headers[i];
+		if(header.cam_index != static_cast<int32_t>(i)) return -2;
+		if(header.data_size == 0)
+		{
+			frame_set.images[i].release();//Padded set
+		}
+		else
+		{
+			if(header.data_offset > record->record_size || header.data_size > record->record_size - header.data_offset || !image_fits(header)) return -2;
+			void * image_data = const_cast<unsigned char*>(data + offset + header.data_offset);
+			frame_set.images[i] = cv::Mat(header.rows, header.cols, header.type, image_data, header.step);
+		}
+		frame_set.frame_info[i].device_timestamp_us = header.device_timestamp_us;
+		frame_set.frame_info[i].host_tp = clock_type::time_point(std::chrono::duration_cast<clock_type::duration>(std::chrono::microseconds(header.host_timestamp_us)));
+	}
+	frame_set.timestamp = record->timestamp;
+	frame_set.seq = record->seq;
+
+	return 0;
+}
+
+int64_t Recording_reader::get_timestamp(size_t n) const
+{
+	return n < entry_count ? entries[n].timestamp : -1;
+}
+
+uint64_t Recording_reader::get_seq(size_t n) const
+{
+	return n < entry_count ? entries[n].seq : 0;
+}
+
+uint32_t Recording_reader::get_cam_mask(size_t n) const
+{
+	return n < entry_count ? entries[n].cam_mask : 0;
+}
+
+size_t Recording_reader::find(int64_t timestamp) const
+{
+	//The timestamps of the sets are increasing, so a binary search on the index is enough
+	const rec::Index_entry * it = std::lower_bound(entries, entries + entry_count, timestamp,
+				[](const rec::Index_entry& entry, int64_t t){return entry.timestamp < t;});
+	return it - entries;
+}
+
+//Private functions:
+const unsigned char * Recording_reader::map_file(const std::string& file_name, size_t& size)
+{
+	const int fd = ::open(file_name.c_str(), O_RDONLY);
+	if(fd < 0) return nullptr;
+
+	struct stat file_stat;
+	void * ptr = MAP_FAILED;
+	if(fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+	{
+		size = file_stat.st_size;
+		ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	::close(fd);//The mapping stays valid
+
+	return ptr == MAP_FAILED ? nullptr : static_cast<const unsigned char*>(ptr);
+}
+
+bool Recording_reader::load_index(const std::string& index_name)
+{
+	index_data = map_file(index_name, index_size);
+	if(!index_data) return false;
+
+	const rec::Index_header * header = reinterpret_cast<const rec::Index_header*>(index_data);
+	if(index_size < sizeof(rec::Index_header) || std::memcmp(header->magic, rec::index_magic, sizeof(header->magic)) != 0
+			|| header->version != rec::format_version || header->entry_size != sizeof(rec::Index_entry))
+	{
+		std::cerr << "Recording_reader : invalid index " << index_name << ", rebuilding it." << std::endl;
+		munmap(const_cast<unsigned char*>(index_data), index_size);
+		index_data = nullptr;
+		return false;
+	}
+
+	entries = reinterpret_cast<const rec::Index_entry*>(index_data + sizeof(rec::Index_header));
+	entry_count = (index_size - sizeof(rec::Index_header)) / sizeof(rec::Index_entry);
+
+	//If the recording has been interrupted, the index can reference records which have not been written
+	while(entry_count > 0)
+	{
+		const rec::Index_entry& last = entries[entry_count - 1];
+		if(last.offset <= data_size - sizeof(rec::Record_header))
+		{
+			const rec::Record_header * record = reinterpret_cast<const rec::Record_header*>(data + last.offset);
+			if(record->magic == rec::record_magic && record->record_size <= data_size - last.offset) break;
+		}
+		--entry_count;
+	}
+
+	return true;
+}
+
+void Recording_reader::rebuild_index()
+{
+	rebuilt_index.clear();
+
+	uint64_t offset = reinterpret_cast<const rec::File_header*>(data)->header_size;
+	while(offset + sizeof(rec::Record_header) <= data_size)
+	{
+		const rec::Record_header * record = reinterpret_cast<const rec::Record_header*>(data + offset);
+		if(record->magic != rec::record_magic || record->record_size < sizeof(rec::Record_header) || record->record_size > data_size - offset
+				|| sizeof(rec::Record_header) + record->cam_number * sizeof(rec::Image_header) > record->record_size) break;//End of the valid records
+
+		rec::Index_entry entry;
+		entry.offset = offset;
+		entry.timestamp = record->timestamp;
+		entry.seq = record->seq;
+		entry.cam_number = record->cam_number;
+		entry.cam_mask = 0;
+		const rec::Image_header * headers = reinterpret_cast<const rec::Image_header*>(record + 1);
+		for(size_t i = 0; i < record->cam_number && i < 32; ++i)
+		{
+			if(headers[i].data_size > 0) entry.cam_mask |= 1u << i;
+		}
+		rebuilt_index.push_back(entry);
+
+		offset += record->record_size;
+	}
+
+	entries = rebuilt_index.data();
+	entry_count = rebuilt_index.size();
+}
+
+} //namespace cam
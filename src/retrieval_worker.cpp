@@ -0,0 +1,69 @@
+#include "retrieval_worker.hpp"
+
+namespace cam {
+
+Retrieval_worker::Retrieval_worker(Camera_seq& camera_, const Thread_config& config_)
+				: camera(camera_)
+				, config(config_)
+				, target(nullptr)
+				, target_info(nullptr)
+				, done(false)
+				, should_run(true)
+				, result(0)
+{
+	worker_thd = std::thread(&Retrieval_worker::thread_func, this);
+}
+
+Retrieval_worker::~Retrieval_worker()
+{
+	{//Mutex scope
+		std::lock_guard<std::mutex> lock(mtx);
+		should_run = false;
+	}
+	request_cv.notify_all();
+	if(worker_thd.joinable()) worker_thd.join();
+}
+
+void Retrieval_worker::post(cv::Mat& image, Frame_info& info)
+{
+	{//Mutex scope
+		std::lock_guard<std::mutex> lock(mtx);
+		target = &image;
+		target_info = &info;
+		done = false;
+	}
+	request_cv.notify_all();
+}
+
+int Retrieval_worker::wait()
+{
+	std::unique_lock<std::mutex> mlock(mtx);
+	request_cv.wait(mlock, [this]{return done;});
+	return result;
+}
+
+void Retrieval_worker::thread_func()
+{
+	apply_thread_config(config);
+
+	std::unique_lock<std::mutex> mlock(mtx);
+	while(true)
+	{
+		request_cv.wait(mlock, [this]{return target != nullptr || !should_run;});
+		if(!should_run) break;
+
+		cv::Mat * image = target;
+		Frame_info * info = target_info;
+		mlock.unlock();
+		const int ret = camera.retrieve_frame(*image, *info);//The camera can block here, without preventing the other cameras from working
+		info->retrieved_tp = clock_type::now();
+		mlock.lock();
+
+		result = ret;
+		target = nullptr;
+		done = true;
+		request_cv.notify_all();
+	}
+}
+
+} //namespace cam
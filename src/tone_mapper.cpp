@@ -0,0 +1,227 @@
+#include "tone_mapper.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace cam {
+
+namespace {
+
+constexpr int sum_chunk = 8192;//Number of vectors summed in 32 bits before adding to the 64 bits sum (no overflow)
+
+//Minimum, maximum and sum of a row, in one pass
+void row_stats(const uint16_t* src, int count, uint16_t& min_value, uint16_t& max_value, uint64_t& sum)
+{
+	int i = 0;
+
+#if defined(__SSE2__)
+	//SSE2 only has signed 16 bits comparisons : the values are biased by 0x8000, which keeps the order
+	const __m128i bias = _mm_set1_epi16(static_cast<short>(0x8000));
+	const __m128i ones = _mm_set1_epi16(1);
+	__m128i vmin = _mm_set1_epi16(0x7FFF);
+	__m128i vmax = _mm_set1_epi16(static_cast<short>(0x8000));
+	while(i + 8 <= count)
+	{
+		const int end = std::min(count - 7, i + 8 * sum_chunk);
+		const int start = i;
+		__m128i vsum = _mm_setzero_si128();
+		for(; i < end; i += 8)
+		{
+			const __m128i value = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), bias);
+			vmin = _mm_min_epi16(vmin, value);
+			vmax = _mm_max_epi16(vmax, value);
+			vsum = _mm_add_epi32(vsum, _mm_madd_epi16(value, ones));
+		}
+		int32_t sums[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(sums), vsum);
+		const int64_t biased_sum = static_cast<int64_t>(sums[0]) + sums[1] + sums[2] + sums[3];
+		sum += static_cast<uint64_t>(biased_sum + static_cast<int64_t>(0x8000) * (i - start));
+	}
+	if(i > 0)
+	{
+		uint16_t mins[8], maxs[8];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(mins), _mm_xor_si128(vmin, bias));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), _mm_xor_si128(vmax, bias));
+		for(int l = 0; l < 8; ++l)
+		{
+			min_value = std::min(min_value, mins[l]);
+			max_value = std::max(max_value, maxs[l]);
+		}
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	uint16x8_t vmin = vdupq_n_u16(0xFFFF);
+	uint16x8_t vmax = vdupq_n_u16(0);
+	while(i + 8 <= count)
+	{
+		const int end = std::min(count - 7, i + 8 * sum_chunk);
+		uint32x4_t vsum = vdupq_n_u32(0);
+		for(; i < end; i += 8)
+		{
+			const uint16x8_t value = vld1q_u16(src + i);
+			vmin = vminq_u16(vmin, value);
+			vmax = vmaxq_u16(vmax, value);
+			vsum = vpadalq_u16(vsum, value);
+		}
+		uint32_t sums[4];
+		vst1q_u32(sums, vsum);
+		sum += static_cast<uint64_t>(sums[0]) + sums[1] + sums[2] + sums[3];
+	}
+	if(i > 0)
+	{
+		uint16_t mins[8], maxs[8];
+		vst1q_u16(mins, vmin);
+		vst1q_u16(maxs, vmax);
+		for(int l = 0; l < 8; ++l)
+		{
+			min_value = std::min(min_value, mins[l]);
+			max_value = std::max(max_value, maxs[l]);
+		}
+	}
+#endif
+
+	for(; i < count; ++i)
+	{
+		min_value = std::min(min_value, src[i]);
+		max_value = std::max(max_value, src[i]);
+		sum += src[i];
+	}
+}
+
+} //namespace
+
+Tone_mapper::Tone_mapper(Tone_mapping mode_) : mode(mode_), linear_gain(tone_linear_gain_d), plateau(tone_plateau_d)
+{}
+
+void Tone_mapper::set_linear_gain(double gain)
+{
+	if(gain <= 0)
+	{
+		std::cerr << "Tone_mapper : the gain has to be positive." << std::endl;
+		return;
+	}
+	linear_gain = gain;
+}
+
+void Tone_mapper::set_plateau(double plateau_)
+{
+	if(plateau_ <= 0 || plateau_ > 1)
+	{
+		std::cerr << "Tone_mapper : the plateau has to be in ]0,1]." << std::endl;
+		return;
+	}
+	plateau = plateau_;
+}
+
+void Tone_mapper::apply(const cv::Mat& img16, cv::Mat& img8)
+{
+	if(img16.type() != CV_16UC1)
+	{
+		std::cerr << "Tone_mapper : the input image has to be CV_16UC1." << std::endl;
+		return;
+	}
+	img8.create(img16.rows, img16.cols, CV_8UC1);//Does nothing if the buffer already has the right format
+	if(img16.empty()) return;
+
+	//A continuous image is processed as a single row
+	const int rows = img16.isContinuous() && img8.isContinuous() ? 1 : img16.rows;
+	const int cols = static_cast<int>(img16.total() / rows);
+
+	uint16_t min_value = 0xFFFF;
+	uint16_t max_value = 0;
+	uint64_t sum = 0;
+	for(int r = 0; r < rows; ++r)
+	{
+		row_stats(img16.ptr<uint16_t>(r), cols, min_value, max_value, sum);
+	}
+
+	build_lut(img16, min_value, max_value, sum);
+
+	const uint8_t* table = lut.data();
+	for(int r = 0; r < rows; ++r)
+	{
+		const uint16_t* src = img16.ptr<uint16_t>(r);
+		uint8_t* dst = img8.ptr<uint8_t>(r);
+		for(int c = 0; c < cols; ++c)
+		{
+			dst[c] = table[src[c] - min_value];
+		}
+	}
+}
+
+//Private functions:
+void Tone_mapper::build_lut(const cv::Mat& img16, uint16_t min_value, uint16_t max_value, uint64_t sum)
+{
+	const size_t range = static_cast<size_t>(max_value - min_value) + 1;
+	lut.resize(range);//Only allocates when the range of the images grows
+
+	switch(mode)
+	{
+		case tone_min_max:
+		{
+			const float scale = range > 1 ? 255.0f / (range - 1) : 0.0f;
+			const float offset = range > 1 ? 0.0f : 127.0f;
+			for(size_t k = 0; k < range; ++k) lut[k] = cv::saturate_cast<uint8_t>(k * scale + offset);
+			break;
+		}
+		case tone_histogram:
+		case tone_plateau:
+		{
+			histogram.assign(range, 0);
+			const int rows = img16.isContinuous() ? 1 : img16.rows;
+			const int cols = static_cast<int>(img16.total() / rows);
+			for(int r = 0; r < rows; ++r)
+			{
+				const uint16_t* src = img16.ptr<uint16_t>(r);
+				for(int c = 0; c < cols; ++c) ++histogram[src[c] - min_value];
+			}
+
+			const uint32_t bin_limit = mode == tone_plateau ? std::max<uint32_t>(1, static_cast<uint32_t>(plateau * img16.total())) : UINT32_MAX;
+			build_equalization_lut(bin_limit);
+			break;
+		}
+		case tone_linear:
+		default:
+		{
+			//Same values as convertTo(img8, CV_8U, gain, 127 - mean * gain)
+			const double mean = static_cast<double>(sum) / img16.total();
+			const float gain = static_cast<float>(linear_gain);
+			const float offset = static_cast<float>(127 - mean * linear_gain);
+			for(size_t k = 0; k < range; ++k) lut[k] = cv::saturate_cast<uint8_t>(static_cast<float>(min_value + k) * gain + offset);
+			break;
+		}
+	}
+}
+
+void Tone_mapper::build_equalization_lut(uint32_t bin_limit)
+{
+	//Cumulative distribution of the (clipped) histogram, the first bin is mapped to 0 and the last one to 255
+	uint64_t total = 0;
+	for(uint32_t& count : histogram)
+	{
+		count = std::min(count, bin_limit);
+		total += count;
+	}
+
+	const uint64_t first = histogram[0];
+	if(total <= first)
+	{
+		std::fill(lut.begin(), lut.end(), 127);//Uniform image
+		return;
+	}
+
+	const float scale = 255.0f / (total - first);
+	uint64_t cumulated = 0;
+	for(size_t k = 0; k < histogram.size(); ++k)
+	{
+		cumulated += histogram[k];
+		lut[k] = cv::saturate_cast<uint8_t>((cumulated - first) * scale);
+	}
+}
+
+} //namespace cam
@@ -1,5 +1,6 @@
 #include "trigger.hpp"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
@@ -7,23 +8,58 @@
 
 #ifdef __unix__
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
+#include <climits>
+#endif
+
+#ifdef __linux__
+#include <linux/serial.h>
+#include <sys/ioctl.h>
 #endif
 
 #include <chrono>
+#include <fstream>
 #include <thread>
 
 namespace cam {
 
 //Good tuto on serial : http://www.cmrr.umn.edu/~strupp/serial.html#1
 
+namespace {
+
+constexpr int reader_poll_ms = 100;//Maximum time the reader thread waits for data, before checking the lost triggers and should_run
+constexpr uint8_t ack_payload_length = 6;
+constexpr uint8_t pong_payload_length = 2;
+
+} //namespace
+
 Trigger_vcp::Trigger_vcp() :
 					opened(false)
+					#ifdef __unix__
+					, config_baudrate(B115200)
+					#endif
+					, last_trigger_seq(0)
+					, burst_period_us(0)
+					, lost_triggers(0)
+					, last_pong_seq(-1)
+					, reader_should_run(false)
 {}
 
+#ifdef __unix__
+Trigger_vcp::Trigger_vcp(const std::string& port_name, const speed_t& baudrate) : Trigger_vcp()
+{
+	config_port_name = port_name;
+	config_baudrate = baudrate;
+}
+#endif
+
 
 Trigger_vcp::~Trigger_vcp()
 {
+	reader_should_run.store(false);
+	if(reader_thd.joinable()) reader_thd.join();
+
 	#ifdef __unix__
 	if(opened) close(fd);
 	#endif
@@ -42,9 +78,21 @@ void Trigger_vcp::open_vcp(const std::string& port_name, const speed_t& baudrate
         return;
     }
     /*baudrate 115200, 8 bits, no parity, 1 stop bit */
-    if(set_interface_attribs(fd, baudrate) < 0) return;
+    if(set_interface_attribs(fd, baudrate) < 0)
+    {
+        close(fd);
+        return;
+    }
+    if(set_low_latency(port_name) != 0)
+    {
+        printf("Warning : the low latency mode of %s could not be fully set, the triggers may be delayed.\n", port_name.c_str());
+    }
 
-    opened = true;	
+    opened = true;
+    reader_should_run.store(true);
+    reader_thd = std::thread(&Trigger_vcp::reader_func, this);
+
+    measure_round_trip();
 }
 #else
 void Trigger_vcp::open_vcp()
@@ -53,52 +101,398 @@ void Trigger_vcp::open_vcp()
 }
 #endif
 
+bool Trigger_vcp::open_trigger()
+{
+	#ifdef __unix__
+	if(config_port_name.empty())
+	{
+		printf("Error opening the trigger : no port given to the constructor.\n");
+		return false;
+	}
+	open_vcp(config_port_name, config_baudrate);
+	#else
+	open_vcp();
+	#endif
+	return opened;
+}
+
 int Trigger_vcp::set_interface_attribs(int fd, int speed)
 {
 	#ifdef __unix__
     struct termios tty;
+    if (tcgetattr(fd, &tty) != 0) //Start from the current options of the device
+    {
+        printf("Error from tcgetattr: %s\n", strerror(errno));
+        return -1;
+    }
 
-    cfsetospeed(&tty, static_cast<speed_t>(speed));
-    cfsetispeed(&tty, static_cast<speed_t>(speed));
-
-    tty.c_cflag = speed | CS8 | CREAD | CLOCAL;
-    tty.c_iflag = IGNPAR;
-    tty.c_oflag = 0;
-    tty.c_lflag = 0;
-    tty.c_cc[VTIME] = 1; // inter-character timer used, in 1/10 seconds
+    cfmakeraw(&tty);//8 bits, no parity, no echo, no translation of the bytes
+    tty.c_cflag &= ~(CSTOPB | CRTSCTS);//1 stop bit, no hardware flow control
+    tty.c_cflag |= CREAD | CLOCAL;
+    tty.c_cc[VTIME] = 0; //The reader thread waits with poll
     tty.c_cc[VMIN] = 0;
 
+    if (cfsetospeed(&tty, static_cast<speed_t>(speed)) != 0 || cfsetispeed(&tty, static_cast<speed_t>(speed)) != 0)
+    {
+        printf("Error from cfsetspeed: %s\n", strerror(errno));
+        return -1;
+    }
+
     if (tcsetattr(fd, TCSANOW, &tty) != 0) //Apply the options to the device
     {
         printf("Error from tcsetattr: %s\n", strerror(errno));
         return -1;
     }
+    tcflush(fd, TCIOFLUSH);//Discard what has been received before the configuration
     return 0;
     #else
     return -1;
     #endif
 }
 
+int Trigger_vcp::set_low_latency(const std::string& port_name)
+{
+	#ifdef __linux__
+	int ret_value = 0;
+
+	//Ask the driver to push the received bytes immediately (not supported by every driver, e.g. cdc_acm)
+	struct serial_struct serial;
+	if(ioctl(fd, TIOCGSERIAL, &serial) == 0)
+	{
+		serial.flags |= ASYNC_LOW_LATENCY;
+		if(ioctl(fd, TIOCSSERIAL, &serial) != 0) ret_value = -1;
+	}
+
+	//The FTDI driver also buffers the bytes up to its latency timer, only configurable through sysfs.
+	//The port is usually a udev symlink (/dev/ttyTRIGGER), the sysfs entry is named after the real device.
+	char real_path[PATH_MAX];
+	if(realpath(port_name.c_str(), real_path) != nullptr)
+	{
+		const char* device_name = std::strrchr(real_path, '/');
+		const std::string timer_path = std::string("/sys/bus/usb-serial/devices/") + (device_name ? device_name + 1 : real_path) + "/latency_timer";
+		if(access(timer_path.c_str(), F_OK) == 0)//Only FTDI-like converters have a latency timer
+		{
+			std::ofstream timer_file(timer_path);
+			timer_file << trigger_latency_timer_ms << std::endl;
+			if(!timer_file) ret_value = -1;//Writing the latency timer usually requires a udev rule (see trigger/95-ftdi-trigger.rules)
+		}
+	}
+
+	return ret_value;
+	#else
+	(void)port_name;
+	return 0;
+	#endif
+}
+
+void Trigger_vcp::measure_round_trip()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	round_trip = Trigger_round_trip();
+	double sum_us = 0;
+	uint16_t seq = 0;
+
+	//The device may still be starting : it is pinged until it answers, then the round trip is measured
+	const clock_type::time_point startup_end_tp = clock_type::now() + std::chrono::milliseconds(trigger_startup_ms);
+	bool answered = false;
+	while(!answered && clock_type::now() < startup_end_tp)
+	{
+		++seq;
+		const uint8_t payload[2] = {static_cast<uint8_t>(seq & 0xFF), static_cast<uint8_t>(seq >> 8)};
+		if(!send_message(trigger_msg_ping, payload, sizeof(payload))) break;
+
+		//The lock is released while waiting, so that the reader thread can store the pong
+		answered = pong_cv.wait_for(lock, std::chrono::milliseconds(trigger_ping_timeout_ms), [this, seq]{return last_pong_seq == seq;});
+	}
+
+	for(int i = 0; answered && i < trigger_ping_number; ++i)
+	{
+		++seq;
+		const uint8_t payload[2] = {static_cast<uint8_t>(seq & 0xFF), static_cast<uint8_t>(seq >> 8)};
+		const clock_type::time_point sent_tp = clock_type::now();
+		if(!send_message(trigger_msg_ping, payload, sizeof(payload))) break;
+
+		if(!pong_cv.wait_for(lock, std::chrono::milliseconds(trigger_ping_timeout_ms), [this, seq]{return last_pong_seq == seq;})) continue;
+
+		const double rtt_us = std::chrono::duration<double, std::micro>(clock_type::now() - sent_tp).count();
+		round_trip.min_us = round_trip.samples == 0 ? rtt_us : std::min(round_trip.min_us, rtt_us);
+		round_trip.max_us = std::max(round_trip.max_us, rtt_us);
+		sum_us += rtt_us;
+		++round_trip.samples;
+	}
+
+	if(round_trip.samples > 0)
+	{
+		round_trip.mean_us = sum_us / round_trip.samples;
+	}
+	else
+	{
+		printf("Warning : the trigger device does not answer, please check that trigger/trigger.ino is up to date.\n");
+	}
+}
+
+Trigger_round_trip Trigger_vcp::get_round_trip() const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return round_trip;
+}
+
 bool Trigger_vcp::send_trigger()
 {
 	if(!opened) return false;
-	
+
+	std::lock_guard<std::mutex> lock(mtx);
+	const uint16_t seq = last_trigger_seq + 1;
+	const uint8_t payload[2] = {static_cast<uint8_t>(seq & 0xFF), static_cast<uint8_t>(seq >> 8)};
+	if(!send_message(trigger_msg_trigger, payload, sizeof(payload))) return false;
+
+	last_trigger_tp = clock_type::now();
+	last_trigger_seq = seq;
+
+	Ack_slot& slot = slots[seq % trigger_ack_history];
+	if(slot.ack.sent_tp != clock_type::time_point() && !slot.acked && !slot.lost) ++lost_triggers;//Replaced before its timeout (more than trigger_ack_history triggers in trigger_ack_timeout_ms)
+	slot = Ack_slot();
+	slot.ack.seq = seq;
+	slot.ack.sent_tp = last_trigger_tp;
+
+	return true;
+}
+
+bool Trigger_vcp::start_burst(uint16_t count, uint32_t period_us)
+{
+	if(!opened) return false;
+
+	std::lock_guard<std::mutex> lock(mtx);
+	const uint16_t seq = last_trigger_seq + 1;
+	const uint8_t payload[8] = {static_cast<uint8_t>(seq & 0xFF), static_cast<uint8_t>(seq >> 8),
+								static_cast<uint8_t>(count & 0xFF), static_cast<uint8_t>(count >> 8),
+								static_cast<uint8_t>(period_us & 0xFF), static_cast<uint8_t>((period_us >> 8) & 0xFF),
+								static_cast<uint8_t>((period_us >> 16) & 0xFF), static_cast<uint8_t>(period_us >> 24)};
+	if(!send_message(trigger_msg_burst, payload, sizeof(payload))) return false;
+
+	last_trigger_tp = clock_type::now();
+	last_trigger_seq = seq + count - 1;//The next single trigger follows the burst (the ids of a free run are not reserved)
+	burst_period_us = count == 0 ? period_us : 0;//The end of a finite burst is not tracked, its pulses are not waited for
+
+	return true;
+}
+
+bool Trigger_vcp::stop_burst()
+{
+	if(!opened) return false;
+
+	std::lock_guard<std::mutex> lock(mtx);
+	if(!send_message(trigger_msg_stop, nullptr, 0)) return false;
+
+	burst_period_us = 0;
+	return true;
+}
+
+bool Trigger_vcp::get_ack(uint16_t seq, Trigger_ack& ack)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	const Ack_slot& slot = slots[seq % trigger_ack_history];
+	if(!slot.acked || slot.ack.seq != seq) return false;
+
+	ack = slot.ack;
+	int64_t offset_us = 0;
+	if(clock_offset_us(offset_us)) ack.pulse_tp = clock_type::time_point(std::chrono::duration_cast<clock_type::duration>(std::chrono::microseconds(ack.device_us + offset_us)));
+	return true;
+}
+
+bool Trigger_vcp::get_pulse_before(const clock_type::time_point& tp, Trigger_ack& ack)
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	int64_t offset_us = 0;
+	if(!clock_offset_us(offset_us)) return false;
+
+	//The pulses are compared in the device clock : the acknowledgement of the pulse may be received after tp
+	const int64_t tp_device_us = std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count() - offset_us;
+	const Ack_slot* latest = latest_pulse_before(tp_device_us);
+	if(!latest) return false;
+
+	//The next pulse of the burst should have been generated before tp : wait for its acknowledgement
+	const int64_t latest_us = latest->ack.device_us;
+	if(burst_period_us > 0 && latest_us + burst_period_us <= tp_device_us)
+	{
+		ack_cv.wait_for(lock, std::chrono::milliseconds(trigger_ack_timeout_ms), [this, latest_us, tp_device_us]{
+			const Ack_slot* slot = latest_pulse_before(tp_device_us);
+			return slot && slot->ack.device_us > latest_us;
+		});
+		latest = latest_pulse_before(tp_device_us);
+	}
+
+	ack = latest->ack;
+	ack.pulse_tp = clock_type::time_point(std::chrono::duration_cast<clock_type::duration>(std::chrono::microseconds(ack.device_us + offset_us)));
+	return true;
+}
+
+//Private functions:
+bool Trigger_vcp::send_message(uint8_t type, const uint8_t* payload, uint8_t length)
+{
 	#ifdef __unix__
-    int bytes_written;
-	//Send the trigger signal, returns true if success, else false.
+	uint8_t message[3 + 255 + 1];
+	message[0] = trigger_sync_byte;
+	message[1] = type;
+	message[2] = length;
+	uint8_t checksum = type ^ length;
+	for(uint8_t i = 0; i < length; ++i)
+	{
+		message[3 + i] = payload[i];
+		checksum ^= payload[i];
+	}
+	message[3 + length] = checksum;
 
-	constexpr char byte_to_send = trigger_byte;
+	const ssize_t size = 4 + length;
+	return write(fd, message, size) == size;//The message is small enough to be written at once
+	#else
+	return false;
+	#endif
+}
 
-    bytes_written = write(fd, &byte_to_send, 1);
-    if (bytes_written != sizeof(char))
-    {
-        return false;
-    }
+void Trigger_vcp::reader_func()
+{
+	#ifdef __unix__
+	//Parser of the messages sent by the device, same states as the parser of trigger.ino
+	int state = 0;
+	uint8_t type = 0;
+	uint8_t length = 0;
+	uint8_t count = 0;
+	uint8_t checksum = 0;
+	uint8_t payload[255];
 
-    return true;
-    #else
-    return false;
-    #endif
+	//Unwrapping of the 32 bits counter of the device
+	bool has_device_us = false;
+	uint32_t last_device_us = 0;
+	int64_t device_us_high = 0;
+
+	uint8_t buffer[256];
+	while(reader_should_run.load())
+	{
+		pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		const int ready = poll(&pfd, 1, reader_poll_ms);
+		const ssize_t size = ready > 0 ? read(fd, buffer, sizeof(buffer)) : 0;
+
+		for(ssize_t b = 0; b < size; ++b)
+		{
+			const uint8_t byte = buffer[b];
+			switch(state)
+			{
+				case 0:
+					if(byte == trigger_sync_byte) state = 1;
+					break;
+				case 1:
+					type = byte;
+					checksum = byte;
+					state = 2;
+					break;
+				case 2:
+					length = byte;
+					checksum ^= byte;
+					count = 0;
+					state = length > 0 ? 3 : 4;
+					break;
+				case 3:
+					payload[count++] = byte;
+					checksum ^= byte;
+					if(count == length) state = 4;
+					break;
+				default:
+					state = 0;
+					if(byte != checksum) break;//Corrupted message
+					if(type == trigger_msg_pong && length == pong_payload_length)
+					{
+						receive_pong(static_cast<uint16_t>(payload[0] | (payload[1] << 8)));
+						break;
+					}
+					if(type != trigger_msg_ack || length != ack_payload_length) break;//Unknown message
+
+					const uint16_t seq = static_cast<uint16_t>(payload[0] | (payload[1] << 8));
+					const uint32_t device_us = static_cast<uint32_t>(payload[2]) | (static_cast<uint32_t>(payload[3]) << 8)
+											   | (static_cast<uint32_t>(payload[4]) << 16) | (static_cast<uint32_t>(payload[5]) << 24);
+					if(has_device_us && device_us < last_device_us) device_us_high += (static_cast<int64_t>(1) << 32);
+					has_device_us = true;
+					last_device_us = device_us;
+
+					receive_ack(seq, device_us_high + device_us);
+					break;
+			}
+		}
+
+		check_lost_triggers(clock_type::now());
+	}
+	#endif
+}
+
+void Trigger_vcp::receive_ack(uint16_t seq, int64_t device_us)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	Ack_slot& slot = slots[seq % trigger_ack_history];
+	if(slot.ack.seq != seq || slot.acked)
+	{
+		//Pulse of a burst (or acknowledgement of a trigger older than the history)
+		slot = Ack_slot();
+		slot.ack.seq = seq;
+	}
+	slot.ack.device_us = device_us;
+	slot.ack.ack_tp = clock_type::now();
+	slot.acked = true;
+	ack_cv.notify_all();
+}
+
+bool Trigger_vcp::clock_offset_us(int64_t& offset_us) const
+{
+	//The acknowledgement received the fastest gives the offset, up to the transmission time of the acknowledgement :
+	//it is estimated as half the minimum round trip time. Only the recent acknowledgements are used, so the drift of the clocks is followed.
+	bool found = false;
+	int64_t min_delay_us = 0;
+	for(const Ack_slot& slot : slots)
+	{
+		if(!slot.acked) continue;
+		const int64_t delay_us = std::chrono::duration_cast<std::chrono::microseconds>(slot.ack.ack_tp.time_since_epoch()).count() - slot.ack.device_us;
+		if(!found || delay_us < min_delay_us) min_delay_us = delay_us;
+		found = true;
+	}
+	if(!found) return false;
+
+	offset_us = min_delay_us - (round_trip.samples > 0 ? static_cast<int64_t>(round_trip.min_us / 2) : 0);
+	return true;
+}
+
+const Trigger_vcp::Ack_slot* Trigger_vcp::latest_pulse_before(int64_t device_us) const
+{
+	const Ack_slot* latest = nullptr;
+	for(const Ack_slot& slot : slots)
+	{
+		if(slot.acked && slot.ack.device_us <= device_us && (!latest || slot.ack.device_us > latest->ack.device_us)) latest = &slot;
+	}
+	return latest;
+}
+
+void Trigger_vcp::receive_pong(uint16_t seq)
+{
+	{//Mutex scope
+		std::lock_guard<std::mutex> lock(mtx);
+		last_pong_seq = seq;
+	}
+	pong_cv.notify_all();
+}
+
+void Trigger_vcp::check_lost_triggers(const clock_type::time_point& now)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	for(Ack_slot& slot : slots)
+	{
+		if(!slot.acked && !slot.lost && slot.ack.sent_tp != clock_type::time_point()
+		   && now - slot.ack.sent_tp > std::chrono::milliseconds(trigger_ack_timeout_ms))
+		{
+			slot.lost = true;
+			++lost_triggers;
+		}
+	}
 }
 
 } //end of cam namespace
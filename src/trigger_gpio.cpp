@@ -0,0 +1,104 @@
+#include "trigger_gpio.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+
+namespace cam {
+
+Trigger_gpio::Trigger_gpio(const std::string& chip_path_, unsigned int line_, bool active_low_, int pulse_us_) :
+					chip_path(chip_path_)
+					, line(line_)
+					, active_low(active_low_)
+					, pulse_us(pulse_us_ > 0 ? pulse_us_ : gpio_pulse_us_d)
+					, line_fd(-1)
+{}
+
+Trigger_gpio::~Trigger_gpio()
+{
+	stop_pulses();//Before closing the line
+
+	#ifdef __linux__
+	if(line_fd >= 0)
+	{
+		set_line(false);
+		close(line_fd);
+	}
+	#endif
+}
+
+bool Trigger_gpio::open_trigger()
+{
+	if(is_opened()) return true;
+
+	#ifdef __linux__
+	const int chip_fd = open(chip_path.c_str(), O_RDWR | O_CLOEXEC);
+	if(chip_fd < 0)
+	{
+		printf("Error opening %s: %s\n", chip_path.c_str(), std::strerror(errno));
+		return false;
+	}
+
+	//The line is requested as an output, inactive until the first pulse. The polarity is handled by the kernel.
+	struct gpiohandle_request request;
+	std::memset(&request, 0, sizeof(request));
+	request.lineoffsets[0] = line;
+	request.lines = 1;
+	request.flags = GPIOHANDLE_REQUEST_OUTPUT | (active_low ? GPIOHANDLE_REQUEST_ACTIVE_LOW : 0);
+	request.default_values[0] = 0;
+	std::strncpy(request.consumer_label, "uasl_trigger", sizeof(request.consumer_label) - 1);
+
+	const int ret = ioctl(chip_fd, GPIO_GET_LINEHANDLE_IOCTL, &request);
+	const int request_errno = errno;
+	close(chip_fd);//The line stays requested through its own file descriptor
+	if(ret < 0)
+	{
+		printf("Error requesting the line %u of %s: %s\n", line, chip_path.c_str(), std::strerror(request_errno));
+		return false;
+	}
+
+	line_fd = request.fd;
+	return true;
+	#else
+	printf("Error opening the trigger : GPIO TRIGGER ONLY DEFINED IN LINUX");
+	return false;
+	#endif
+}
+
+//Protected functions:
+bool Trigger_gpio::fire_pulse(clock_type::time_point& pulse_tp)
+{
+	if(set_line(true) != 0) return false;
+	pulse_tp = clock_type::now();
+
+	//Busy wait : the pulse is much shorter than the granularity of the scheduler
+	const clock_type::time_point end_tp = pulse_tp + std::chrono::microseconds(pulse_us);
+	while(clock_type::now() < end_tp) {}
+
+	return set_line(false) == 0;
+}
+
+//Private functions:
+int Trigger_gpio::set_line(bool active)
+{
+	#ifdef __linux__
+	struct gpiohandle_data data;
+	std::memset(&data, 0, sizeof(data));
+	data.values[0] = active ? 1 : 0;
+	return ioctl(line_fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) < 0 ? -1 : 0;
+	#else
+	(void)active;
+	return -1;
+	#endif
+}
+
+} //end of cam namespace
@@ -0,0 +1,143 @@
+#include "trigger_local.hpp"
+
+#include <chrono>
+
+namespace cam {
+
+Trigger_local::Trigger_local() : last_trigger_seq(0), lost_triggers(0), burst_should_run(false)
+{
+	acked.fill(false);
+}
+
+Trigger_local::~Trigger_local()
+{
+	stop_pulses();
+}
+
+bool Trigger_local::send_trigger()
+{
+	if(!is_opened()) return false;
+
+	std::lock_guard<std::mutex> lock(mtx);
+	const uint16_t seq = last_trigger_seq + 1;
+	const clock_type::time_point sent_tp = clock_type::now();
+	if(!pulse(seq, sent_tp)) return false;
+
+	last_trigger_tp = sent_tp;
+	last_trigger_seq = seq;
+	return true;
+}
+
+clock_type::time_point Trigger_local::get_last_trigger_tp() const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return last_trigger_tp;
+}
+
+uint16_t Trigger_local::get_last_trigger_seq() const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return last_trigger_seq;
+}
+
+bool Trigger_local::start_burst(uint16_t count, uint32_t period_us)
+{
+	if(!is_opened() || period_us == 0) return false;
+
+	stop_pulses();//A new burst replaces the current one
+
+	std::lock_guard<std::mutex> lock_burst(burst_mtx);
+	uint16_t first_seq;
+	{//Mutex scope
+		std::lock_guard<std::mutex> lock(mtx);
+		first_seq = last_trigger_seq + 1;
+		last_trigger_tp = clock_type::now();
+		last_trigger_seq = first_seq + count - 1;//The next single trigger follows the burst (the ids of a free run are not reserved)
+	}
+
+	burst_should_run.store(true);
+	burst_thd = std::thread(&Trigger_local::burst_func, this, first_seq, count, period_us);
+	return true;
+}
+
+bool Trigger_local::stop_burst()
+{
+	if(!is_opened()) return false;
+
+	stop_pulses();
+	return true;
+}
+
+bool Trigger_local::get_ack(uint16_t seq, Trigger_ack& ack)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	const size_t idx = seq % trigger_ack_history;
+	if(!acked[idx] || slots[idx].seq != seq) return false;
+
+	ack = slots[idx];
+	return true;
+}
+
+bool Trigger_local::get_pulse_before(const clock_type::time_point& tp, Trigger_ack& ack)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	const Trigger_ack* latest = nullptr;
+	for(size_t i = 0; i < trigger_ack_history; ++i)
+	{
+		if(acked[i] && slots[i].pulse_tp <= tp && (!latest || slots[i].pulse_tp > latest->pulse_tp)) latest = &slots[i];
+	}
+	if(!latest) return false;
+
+	ack = *latest;
+	return true;
+}
+
+//Protected functions:
+void Trigger_local::stop_pulses()
+{
+	std::lock_guard<std::mutex> lock_burst(burst_mtx);
+	burst_should_run.store(false);
+	if(burst_thd.joinable()) burst_thd.join();
+}
+
+//Private functions:
+bool Trigger_local::pulse(uint16_t seq, const clock_type::time_point& sent_tp)
+{
+	const size_t idx = seq % trigger_ack_history;
+	clock_type::time_point pulse_tp;
+	if(!fire_pulse(pulse_tp))
+	{
+		++lost_triggers;
+		acked[idx] = false;
+		return false;
+	}
+
+	Trigger_ack& ack = slots[idx];
+	ack = Trigger_ack();
+	ack.seq = seq;
+	ack.device_us = std::chrono::duration_cast<std::chrono::microseconds>(pulse_tp.time_since_epoch()).count();
+	ack.sent_tp = sent_tp;
+	ack.ack_tp = clock_type::now();
+	ack.pulse_tp = pulse_tp;
+	acked[idx] = true;
+	return true;
+}
+
+void Trigger_local::burst_func(uint16_t first_seq, uint16_t count, uint32_t period_us)
+{
+	//The pulses are scheduled from the first one, so that the period does not drift
+	clock_type::time_point next_tp = clock_type::now();
+	uint16_t seq = first_seq;
+	for(unsigned int k = 0; burst_should_run.load() && (count == 0 || k < count); ++k)
+	{
+		std::this_thread::sleep_until(next_tp);
+		if(!burst_should_run.load()) break;
+		{//Mutex scope
+			std::lock_guard<std::mutex> lock(mtx);
+			pulse(seq++, clock_type::time_point());
+		}
+		next_tp += std::chrono::microseconds(period_us);
+	}
+}
+
+} //end of cam namespace
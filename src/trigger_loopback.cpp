@@ -0,0 +1,46 @@
+#include "trigger_loopback.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace cam {
+
+Trigger_loopback::Trigger_loopback() : pulse_count(0)
+{}
+
+Trigger_loopback::~Trigger_loopback()
+{
+	stop_pulses();
+}
+
+uint64_t Trigger_loopback::get_pulse_count() const
+{
+	std::lock_guard<std::mutex> lock(pulse_mtx);
+	return pulse_count;
+}
+
+bool Trigger_loopback::wait_pulse(uint64_t& last_pulse, clock_type::time_point& pulse_tp, int timeout_ms)
+{
+	std::unique_lock<std::mutex> lock(pulse_mtx);
+	if(!pulse_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this, &last_pulse]{return pulse_count > last_pulse;})) return false;
+
+	const uint64_t oldest_pulse = pulse_count > loopback_pulse_history ? pulse_count - loopback_pulse_history + 1 : 1;
+	last_pulse = std::max(last_pulse + 1, oldest_pulse);
+	pulse_tp = pulse_history[last_pulse % loopback_pulse_history];
+	return true;
+}
+
+//Protected functions:
+bool Trigger_loopback::fire_pulse(clock_type::time_point& pulse_tp)
+{
+	pulse_tp = clock_type::now();
+	{//Mutex scope
+		std::lock_guard<std::mutex> lock(pulse_mtx);
+		++pulse_count;
+		pulse_history[pulse_count % loopback_pulse_history] = pulse_tp;
+	}
+	pulse_cv.notify_all();
+	return true;
+}
+
+} //end of cam namespace
@@ -0,0 +1,65 @@
+#include "util_thread.hpp"
+
+#include <iostream>
+#include <cstring>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cam
+{
+
+#ifdef __linux__
+namespace
+{
+
+int apply_config(pthread_t thd, const Thread_config& config)
+{
+	int ret = 0;
+
+	if(config.cpu >= 0)
+	{
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		CPU_SET(config.cpu, &cpu_set);//Ignored if cpu >= CPU_SETSIZE, the empty set is then rejected
+		const int err = pthread_setaffinity_np(thd, sizeof(cpu_set), &cpu_set);
+		if(err != 0)
+		{
+			std::cerr << "Warning : the thread could not be pinned on core " << config.cpu << " (" << std::strerror(err) << ")." << std::endl;
+			ret = -1;
+		}
+	}
+
+	if(config.rt_priority > 0)
+	{
+		sched_param param;
+		param.sched_priority = config.rt_priority;
+		const int err = pthread_setschedparam(thd, SCHED_FIFO, &param);
+		if(err != 0)
+		{
+			std::cerr << "Warning : the real-time scheduling (priority " << config.rt_priority << ") could not be set (" << std::strerror(err) << "), the normal scheduling is kept." << std::endl;
+			ret = -2;
+		}
+	}
+
+	return ret;
+}
+
+} //namespace
+#endif
+
+int apply_thread_config(const Thread_config& config)
+{
+	if(config.is_default()) return 0;
+
+	#ifdef __linux__
+	return apply_config(pthread_self(), config);
+	#else
+	std::cerr << "Warning : the configuration of the threads is not supported on this system." << std::endl;
+	return -3;
+	#endif
+}
+
+} //namespace cam
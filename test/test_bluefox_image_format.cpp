@@ -47,7 +47,7 @@ int main()
 	//TEST 16BIT MONO
     i = 0;
     dynamic_cast<cam::BlueFoxParameters&>(acq.get_cam_params(0)).set_image_type(CV_16U);
-    acq.start_acq();
+    acq.wait_param_commands(cam::timeout_delay_ms);//Applied between two frames, the acquisition keeps running
     start = std::chrono::steady_clock::now();
     for(;sig_handle.check_term_sig() && i<max_iter;)
     {
@@ -65,7 +65,7 @@ int main()
 	//TEST 8BIT MONO
     i = 0;
     dynamic_cast<cam::BlueFoxParameters&>(acq.get_cam_params(0)).set_image_type(CV_8U);
-    acq.start_acq();
+    acq.wait_param_commands(cam::timeout_delay_ms);//Applied between two frames, the acquisition keeps running
     start = std::chrono::steady_clock::now();
     for(;sig_handle.check_term_sig() && i<max_iter;)
     {
@@ -83,7 +83,7 @@ int main()
 	//TEST 8BIT RGB
     i = 0;
     dynamic_cast<cam::BlueFoxParameters&>(acq.get_cam_params(0)).set_image_type(CV_8UC3);
-    acq.start_acq();
+    acq.wait_param_commands(cam::timeout_delay_ms);//Applied between two frames, the acquisition keeps running
     start = std::chrono::steady_clock::now();
     for(;sig_handle.check_term_sig() && i<max_iter;)
     {
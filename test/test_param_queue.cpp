@@ -0,0 +1,130 @@
+#include "acquisition.hpp"
+
+#include "camera_synthetic.hpp"
+#include "trigger_loopback.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Modifications of the parameters of synthetic cameras while the acquisition runs (see Camera_params::post_command) :
+// - a live modification is applied between two frames without restarting any camera,
+// - the modifications posted together are applied at once, and only the camera with a modification which is not live is restarted,
+// - wait_param_commands returns once the modifications are applied, also when the acquisition is stopped or has ended by itself.
+//A restart of a synthetic camera is visible in its images : the frame numbers start again from 0.
+//Usage : test_param_queue
+namespace
+{
+
+constexpr int wait_timeout_ms = 2000;
+constexpr int64_t live_offset_us = 1000000000;//Clock offsets given by the modifications, recognizable in the device timestamps
+constexpr int64_t batch_offset_us = 2000000000;
+
+class Failing_trigger : public cam::Trigger_loopback
+{
+	//The free running mode cannot be configured : the acquisition ends by itself
+	public:
+	bool start_burst(uint16_t /*count*/, uint32_t /*period_us*/) override { return false; }
+};
+
+uint64_t frame_number(const cam::Frame_set& frame_set, size_t i)
+{
+	uint64_t frame = 0;
+	std::memcpy(&frame, frame_set.images[i].ptr(0), sizeof(frame));
+	return frame;
+}
+
+//Frame numbers of the next set, false if no set is received
+bool read_frames(cam::Acquisition& acq, std::vector<uint64_t>& frames, cam::Frame_set_ptr& frame_set)
+{
+	if(acq.get_frames(frame_set) < 0) return false;//Timeout of get_frames
+
+	frames.clear();
+	for(size_t i = 0; i < frame_set->images.size(); ++i) frames.push_back(frame_number(*frame_set, i));
+	return true;
+}
+
+//Wait for the first set in which the device timestamp of the camera cam is above offset_us.
+//before has to hold the frame numbers of a set read before the modification, it is updated until the modification is seen.
+bool wait_offset(cam::Acquisition& acq, size_t cam, int64_t offset_us, std::vector<uint64_t>& before, std::vector<uint64_t>& after)
+{
+	cam::Frame_set_ptr frame_set;
+	const std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+	while(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(wait_timeout_ms))
+	{
+		if(!read_frames(acq, after, frame_set)) continue;
+		if(frame_set->frame_info[cam].device_timestamp_us >= offset_us) return true;
+		before = after;
+	}
+	return false;
+}
+
+bool check(const std::string& name, bool value)
+{
+	std::cout << name << " : " << (value ? "ok" : "failed") << std::endl;
+	return value;
+}
+
+} //namespace
+
+int main()
+{
+	bool success = true;
+	std::vector<uint64_t> before, after;
+	cam::Frame_set_ptr frame_set;
+
+	cam::Acquisition acq;
+	for(int i = 0; i < 2; ++i)
+	{
+		acq.add_camera<cam::synthetic>("synthetic_" + std::to_string(i));
+		cam::SyntheticParameters& params = dynamic_cast<cam::SyntheticParameters&>(acq.get_cam_params(i));
+		params.set_image_format(64, 48, CV_8UC1);
+		params.set_rate(200);
+	}
+	cam::SyntheticParameters& params0 = dynamic_cast<cam::SyntheticParameters&>(acq.get_cam_params(0));
+	cam::SyntheticParameters& params1 = dynamic_cast<cam::SyntheticParameters&>(acq.get_cam_params(1));
+	success &= check("applied while stopped", acq.wait_param_commands(0) && params1.get_rate_hz() == 200);
+
+	acq.start_acq();
+	success &= check("acquisition started", read_frames(acq, before, frame_set));
+
+	//Live : no camera is restarted
+	params0.set_clock_offset_us(live_offset_us);
+	success &= check("live modification waited for", acq.wait_param_commands(wait_timeout_ms));
+	success &= check("live modification applied", wait_offset(acq, 0, live_offset_us, before, after));
+	success &= check("no restart for a live modification", after.size() == 2 && after[0] > before[0] && after[1] > before[1]);
+
+	//Batch : the rate restarts the second camera only, the offset posted with it is applied at the same time
+	read_frames(acq, before, frame_set);
+	params1.set_rate(100);
+	params1.set_clock_offset_us(batch_offset_us);
+	success &= check("batch waited for", acq.wait_param_commands(wait_timeout_ms));
+	success &= check("batch applied", wait_offset(acq, 1, batch_offset_us, before, after) && params1.get_rate_hz() == 100);
+	success &= check("only the modified camera restarted", after.size() == 2 && after[0] > before[0] && after[1] < before[1]);
+
+	acq.stop_acq();
+	params0.set_seed(42);
+	success &= check("applied after the stop", acq.wait_param_commands(0) && params0.get_seed() == 42);
+
+	//The acquisition ends by itself : the modifications are still applied
+	std::shared_ptr<Failing_trigger> trigger = std::make_shared<Failing_trigger>();
+	params0.set_trigger(trigger);
+	params1.set_trigger(trigger);
+	acq.set_trigger(trigger);
+	acq.set_trigger_period_us(10000);
+	acq.start_acq();
+	const std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+	while(acq.is_running() && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	params1.set_rate(50);
+	success &= check("applied after the end of the acquisition", !acq.is_running() && acq.wait_param_commands(0) && params1.get_rate_hz() == 50);
+	acq.stop_acq();
+
+	std::cout << (success ? "Success" : "Failure") << std::endl;
+	return success ? 0 : 1;
+}
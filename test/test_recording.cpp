@@ -0,0 +1,163 @@
+#include "recorder.hpp"
+#include "recording_reader.hpp"
+#include "frame_pool.hpp"
+
+#include <opencv2/core/version.hpp>
+#if CV_MAJOR_VERSION == 2
+#include <opencv2/core/core.hpp>
+#elif CV_MAJOR_VERSION == 3
+#include <opencv2/core.hpp>
+#endif
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+//Record synthetic sets, then read them back in random order with the index, and without it.
+//Finally, damage the file : an index of another version has to be rebuilt, and a set whose image does not fit in its record has to be rejected.
+//Usage : test_recording [file] [number of sets] [direct]
+
+static bool check_set(const cam::Frame_set& frame_set, size_t n)
+{
+	if(frame_set.seq != n || frame_set.timestamp != static_cast<int64_t>(n) * 33333 || frame_set.images.size() != 2) return false;
+	if(!frame_set.images[1].empty() != (n % 10 != 0)) return false;//One set out of 10 is padded
+
+	for(size_t i = 0; i < frame_set.images.size(); ++i)
+	{
+		const cv::Mat& img = frame_set.images[i];
+		if(img.empty()) continue;
+		for(int r = 0; r < img.rows; ++r)
+		{
+			const unsigned char * row = img.ptr(r);
+			for(size_t c = 0; c < img.cols * img.elemSize(); ++c)
+			{
+				if(row[c] != static_cast<unsigned char>(n + i + r + c)) return false;
+			}
+		}
+		if(frame_set.frame_info[i].device_timestamp_us != static_cast<int64_t>(n * 1000 + i)) return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	const std::string file_name = argc > 1 ? argv[1] : "test_recording.rec";
+	const size_t set_number = argc > 2 ? std::stoul(argv[2]) : 300;
+	const bool direct_io = argc > 3 && std::string(argv[3]) == "direct";
+
+	cam::Frame_pool pool;
+	std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+	{
+		cam::Recorder recorder(file_name, direct_io, set_number);//Deep enough to never drop a set
+		if(!recorder.is_open()) return 1;
+
+		for(size_t n = 0; n < set_number; ++n)
+		{
+			std::shared_ptr<cam::Frame_set> frame_set = pool.acquire(2);
+			frame_set->images[0].create(480, 752, CV_8UC1);
+			if(n % 10 != 0) frame_set->images[1].create(480, 640, CV_16UC1);
+			else frame_set->images[1].release();//A recycled set keeps the buffers of its previous use
+			for(size_t i = 0; i < 2; ++i)
+			{
+				cv::Mat& img = frame_set->images[i];
+				for(int r = 0; r < img.rows; ++r)
+				{
+					unsigned char * row = img.ptr(r);
+					for(size_t c = 0; c < img.cols * img.elemSize(); ++c) row[c] = static_cast<unsigned char>(n + i + r + c);
+				}
+				frame_set->frame_info[i].device_timestamp_us = n * 1000 + i;
+			}
+			frame_set->timestamp = n * 33333;
+			frame_set->seq = n;
+			recorder.record(frame_set);
+		}
+		recorder.close();
+
+		const double elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		std::cout << recorder.get_written_sets() << " sets written (" << recorder.get_written_bytes() / (1 << 20) << " MiB) in " << elapsed_ms << " ms, "
+				<< recorder.get_dropped_sets() << " dropped." << std::endl;
+		if(recorder.get_written_sets() != set_number) return 1;
+	}
+
+	for(int pass = 0; pass < 2; ++pass)
+	{
+		if(pass == 1) std::remove((file_name + cam::rec::index_suffix).c_str());//Second pass : the reader rebuilds the index
+
+		cam::Recording_reader reader(file_name);
+		if(!reader.is_open() || reader.size() != set_number)
+		{
+			std::cerr << "Unexpected number of sets : " << reader.size() << std::endl;
+			return 1;
+		}
+
+		cam::Frame_set frame_set;
+		for(size_t k = 0; k < set_number; ++k)
+		{
+			const size_t n = (k * 7919) % set_number;//Random access
+			if(reader.read(n, frame_set) != 0 || !check_set(frame_set, n))
+			{
+				std::cerr << "Set " << n << " is corrupted." << std::endl;
+				return 1;
+			}
+		}
+
+		if(reader.find(33333 * 5) != 5 || reader.find(33333 * 5 + 1) != 6 || reader.find(-1) != 0 || reader.find(33333 * set_number) != set_number)
+		{
+			std::cerr << "Search by timestamp failed." << std::endl;
+			return 1;
+		}
+	}
+
+	//Index of another version of the format : ignored and rebuilt
+	{
+		cam::Recorder recorder(file_name, direct_io, set_number);
+		for(size_t n = 0; n < 2; ++n)
+		{
+			std::shared_ptr<cam::Frame_set> frame_set = pool.acquire(1);
+			frame_set->images[0].create(480, 752, CV_8UC1);
+			frame_set->timestamp = n;
+			frame_set->seq = n;
+			recorder.record(frame_set);
+		}
+		recorder.close();
+	}
+	std::fstream index_file(file_name + cam::rec::index_suffix, std::ios::in | std::ios::out | std::ios::binary);
+	cam::rec::Index_header index_header;
+	cam::rec::Index_entry entries[2];
+	index_file.read(reinterpret_cast<char*>(&index_header), sizeof(index_header));
+	index_file.read(reinterpret_cast<char*>(entries), sizeof(entries));
+	index_header.version = cam::rec::format_version - 1;
+	entries[1].timestamp = 1000;//Only visible if the index is used
+	index_file.seekp(0);
+	index_file.write(reinterpret_cast<const char*>(&index_header), sizeof(index_header));
+	index_file.write(reinterpret_cast<const char*>(entries), sizeof(entries));
+	index_file.close();
+
+	//Image of the second set larger than its data
+	std::fstream rec_file(file_name, std::ios::in | std::ios::out | std::ios::binary);
+	const int32_t rows = 1 << 20;
+	rec_file.seekp(entries[1].offset + sizeof(cam::rec::Record_header) + offsetof(cam::rec::Image_header, rows));
+	rec_file.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+	rec_file.close();
+
+	{
+		cam::Recording_reader reader(file_name);
+		cam::Frame_set frame_set;
+		if(!reader.is_open() || reader.size() != 2 || reader.get_timestamp(1) != 1)
+		{
+			std::cerr << "The index of another version has been used." << std::endl;
+			return 1;
+		}
+		if(reader.read(0, frame_set) != 0 || reader.read(1, frame_set) != -2)
+		{
+			std::cerr << "The damaged image header has not been detected." << std::endl;
+			return 1;
+		}
+	}
+
+	std::cout << "Recording OK" << std::endl;
+	return 0;
+}
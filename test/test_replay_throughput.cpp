@@ -0,0 +1,56 @@
+#include "acquisition.hpp"
+
+#include "util_signal.hpp"
+
+#include "camera_replay.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+//Measure the throughput of the acquisition alone by replaying a session as fast as possible
+//Usage : test_replay_throughput session_path [number of recorded cameras] [duration in s]
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		std::cerr << "Usage : " << argv[0] << " session_path [number of recorded cameras] [duration in s]" << std::endl;
+		return 1;
+	}
+	const std::string session_path = argv[1];
+	const int cam_number = argc > 2 ? std::stoi(argv[2]) : 1;
+	const int duration_s = argc > 3 ? std::stoi(argv[3]) : 10;
+
+	cam::SigHandler sig_handle;//Instantiate this class first since the constructor blocks the signal of all future child threads
+
+	cam::Acquisition acq;
+	for(int i = 0; i < cam_number; ++i)
+	{
+		acq.add_camera<cam::replay>(session_path);
+		cam::ReplayParameters& params = dynamic_cast<cam::ReplayParameters&>(acq.get_cam_params(i));
+		params.set_camera_index(i);
+		params.set_pacing(cam::as_fast_as_possible);
+		params.set_loop(true);
+		params.set_preload(true);//Do not measure the PNG decoding
+	}
+
+	cam::Frame_set_ptr frame_set;
+	unsigned int count = 0;
+
+	acq.start_acq();
+	const std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+	std::chrono::time_point<std::chrono::steady_clock> end = start;
+
+	while(sig_handle.check_term_sig() && acq.is_running() && end - start < std::chrono::seconds(duration_s))
+	{
+		if(acq.get_frames(frame_set) >= 0) ++count;
+		end = std::chrono::steady_clock::now();
+	}
+	acq.stop_acq();
+
+	const double elapsed_s = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1e6;
+	std::cout << count << " sets received in " << elapsed_s << " s : " << count / elapsed_s << " sets/s, "
+			<< acq.get_dropped_sets() << " sets dropped by get_frames." << std::endl;
+
+	return 0;
+}
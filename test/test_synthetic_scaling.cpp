@@ -0,0 +1,58 @@
+#include "acquisition.hpp"
+
+#include "util_signal.hpp"
+
+#include "camera_synthetic.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+//Measure the set rate of the acquisition with 1 to max_cameras synthetic cameras, with sequential and parallel retrieval
+//The latencies are upper bounds of the histogram buckets (see Latency_stats)
+//Usage : test_synthetic_scaling [max number of cameras] [frame rate] [duration of each run in s]
+int main(int argc, char** argv)
+{
+	const int max_cameras = argc > 1 ? std::stoi(argv[1]) : 16;
+	const double rate_hz = argc > 2 ? std::stod(argv[2]) : 100.0;
+	const int duration_s = argc > 3 ? std::stoi(argv[3]) : 2;
+
+	cam::SigHandler sig_handle;//Instantiate this class first since the constructor blocks the signal of all future child threads
+
+	std::cout << "cameras, parallel, sets/s, expected sets/s, dropped sets, p99 retrieved us, p99 published us" << std::endl;
+	for(int cam_number = 1; cam_number <= max_cameras && sig_handle.check_term_sig(); cam_number *= 2)
+	{
+		for(int parallel = 0; parallel < 2 && sig_handle.check_term_sig(); ++parallel)
+		{
+			cam::Acquisition acq;
+			for(int i = 0; i < cam_number; ++i)
+			{
+				acq.add_camera<cam::synthetic>("synthetic_" + std::to_string(i));
+				cam::SyntheticParameters& params = dynamic_cast<cam::SyntheticParameters&>(acq.get_cam_params(i));
+				params.set_image_format(752, 480, CV_8UC1);
+				params.set_rate(rate_hz);
+				params.set_latency(2000, 500, cam::latency_normal);
+			}
+			acq.set_parallel_retrieval(parallel != 0);
+
+			cam::Frame_set_ptr frame_set;
+			unsigned int count = 0;
+
+			acq.start_acq();
+			const std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+			std::chrono::time_point<std::chrono::steady_clock> end = start;
+			while(sig_handle.check_term_sig() && acq.is_running() && end - start < std::chrono::seconds(duration_s))
+			{
+				if(acq.get_frames(frame_set) >= 0) ++count;
+				end = std::chrono::steady_clock::now();
+			}
+			acq.stop_acq();
+
+			const double elapsed_s = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1e6;
+			std::cout << cam_number << ", " << parallel << ", " << count / elapsed_s << ", " << rate_hz << ", " << acq.get_dropped_sets()
+					  << ", " << acq.get_latency(cam::stage_retrieved).p99_us << ", " << acq.get_latency(cam::stage_published).p99_us << std::endl;
+		}
+	}
+
+	return 0;
+}
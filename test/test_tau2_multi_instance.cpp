@@ -0,0 +1,164 @@
+#include "tauinterface.h"
+#include "taucom.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Several Tau2 interfaces in the same process, fed concurrently with simulated grabber streams (no hardware needed).
+//Each stream identifies a different core (640x512 and 336x256) and contains frames with values in a different range :
+//every interface has to deliver only its own frames, with its own resolution.
+//Usage : test_tau2_multi_instance [number of frames per interface]
+namespace
+{
+
+struct Instance_desc
+{
+	const char* part_number;//Part number sent by the simulated core, gives the resolution
+	unsigned int width;
+	unsigned int height;
+	uint16_t min_value;//Range of the pixel values of this instance
+	uint16_t max_value;
+};
+
+const Instance_desc instances[] = {{"46640013H-SPNLX^46640013H", 640, 512, 1000, 1999},
+								   {"46336013H-SPNLX^46336013H", 336, 256, 9000, 9999}};
+
+struct Instance_result
+{
+	Instance_result() : frames(0), errors(0) {}
+	const Instance_desc* desc;
+	unsigned int frames;
+	unsigned int errors;
+};
+
+void frame_callback(TauRawBitmap& bitmap, void* caller)
+{
+	Instance_result* result = static_cast<Instance_result*>(caller);
+	++result->frames;
+	if(bitmap.width != result->desc->width || bitmap.height != result->desc->height
+	   || bitmap.min < result->desc->min_value || bitmap.max > result->desc->max_value)
+	{
+		++result->errors;
+	}
+}
+
+//Generates the replies of the simulated core
+class Reply_builder : public TauCom
+{
+	public:
+	void processSerialPacket(uint8_t* /*buffer*/, uint32_t /*size*/) override {}
+}; //class Reply_builder
+
+//UART packet as sent by the grabber : "UART", size (counts one more byte than the data), data
+void append_uart_packet(std::vector<uint8_t>& stream, const uint8_t* data, int size)
+{
+	stream.insert(stream.end(), {'U', 'A', 'R', 'T'});
+	stream.push_back(static_cast<uint8_t>(size + 1));
+	stream.insert(stream.end(), data, data + size);
+}
+
+//Frame as sent by the grabber : "TEAX", number of words, PPS value, pixels with the HSYNC and VSYNC bits set
+void append_frame_packet(std::vector<uint8_t>& stream, const Instance_desc& desc, unsigned int frame)
+{
+	std::vector<uint16_t> words(1, 0x0123);
+	for(unsigned int i = 0; i < desc.width * desc.height; ++i)
+	{
+		const uint16_t value = desc.min_value + static_cast<uint16_t>((i * 13 + frame * 7) % (desc.max_value - desc.min_value + 1));
+		words.push_back(0xC000 | value);
+	}
+
+	const uint32_t size = static_cast<uint32_t>(words.size());
+	stream.insert(stream.end(), {'T', 'E', 'A', 'X'});
+	for(int b = 0; b < 4; ++b) stream.push_back(static_cast<uint8_t>(size >> (8 * b)));
+	for(uint16_t w : words)
+	{
+		stream.push_back(static_cast<uint8_t>(w & 0xFF));
+		stream.push_back(static_cast<uint8_t>(w >> 8));
+	}
+	stream.push_back(0);
+}
+
+std::vector<uint8_t> make_stream(const Instance_desc& desc, unsigned int frame_number)
+{
+	Reply_builder builder;
+	uint8_t reply[64];
+	uint8_t part_number[32] = {0};
+	std::strncpy(reinterpret_cast<char*>(part_number), desc.part_number, sizeof(part_number) - 1);
+
+	std::vector<uint8_t> stream;
+	append_uart_packet(stream, reply, builder.genTauFrame(TAU_NO_OP_CMD, 0, nullptr, reply));
+	append_uart_packet(stream, reply, builder.genTauFrame(TAU_CAMERA_PART_CMD, sizeof(part_number), part_number, reply));
+	for(unsigned int f = 0; f < frame_number; ++f)
+	{
+		append_frame_packet(stream, desc, f);
+		//Replies between the frames, so that the CRC of both interfaces is computed at the same time
+		append_uart_packet(stream, reply, builder.genTauFrame(TAU_NO_OP_CMD, 0, nullptr, reply));
+	}
+	return stream;
+}
+
+} //namespace
+
+int main(int argc, char** argv)
+{
+	const unsigned int frame_number = argc > 1 ? std::stoul(argv[1]) : 50;
+	const int instance_number = sizeof(instances) / sizeof(instances[0]);
+
+	std::vector<Instance_result> results(instance_number);
+	std::vector<std::vector<uint8_t>> streams;
+	std::vector<std::unique_ptr<TauInterface>> interfaces;
+	for(int i = 0; i < instance_number; ++i)
+	{
+		results[i].desc = &instances[i];
+		streams.push_back(make_stream(instances[i], frame_number));
+		interfaces.emplace_back(new TauInterface(frame_callback, &results[i]));
+	}
+
+	//One USB thread per interface, the stream is cut in chunks as the USB transfers would be
+	std::vector<std::thread> threads;
+	for(int i = 0; i < instance_number; ++i)
+	{
+		threads.emplace_back([&interfaces, &streams, i]()
+		{
+			const size_t chunk_size = 16384;
+			std::vector<uint8_t>& stream = streams[i];
+			for(size_t offset = 0; offset < stream.size(); offset += chunk_size)
+			{
+				const int length = static_cast<int>(std::min(chunk_size, stream.size() - offset));
+				interfaces[i]->feedData(stream.data() + offset, length);
+			}
+			interfaces[i]->stopDecoder();//Wait for the last frames
+		});
+	}
+	for(std::thread& t : threads) t.join();
+
+	bool success = true;
+	for(int i = 0; i < instance_number; ++i)
+	{
+		const unsigned int dropped = interfaces[i]->getDroppedFrames();
+		std::cout << "Interface " << i << " (" << interfaces[i]->getWidth() << "x" << interfaces[i]->getHeight() << ", " << interfaces[i]->getCameraPartNumber() << ") : "
+				  << results[i].frames << " frames, " << dropped << " dropped, " << results[i].errors << " errors" << std::endl;
+
+		if(interfaces[i]->getWidth() != instances[i].width || interfaces[i]->getHeight() != instances[i].height
+		   || std::string(interfaces[i]->getCameraPartNumber()) != instances[i].part_number)
+		{
+			std::cerr << "Interface " << i << " did not keep its own core description" << std::endl;
+			success = false;
+		}
+		if(results[i].errors > 0 || results[i].frames + dropped != frame_number || results[i].frames == 0)
+		{
+			std::cerr << "Interface " << i << " did not receive its own frames" << std::endl;
+			success = false;
+		}
+	}
+
+	interfaces.clear();//Stops the watchdogs
+	std::cout << (success ? "Success" : "Failure") << std::endl;
+	return success ? 0 : 1;
+}
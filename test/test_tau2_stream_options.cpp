@@ -0,0 +1,57 @@
+#include "fastftdi.h"
+
+#include <iostream>
+#include <string>
+
+//Sizes of the USB transfers of the grabber computed from the stream options (no hardware needed) :
+//the adaptive length has to stay within its limits whatever the measured rate, and the transfer buffers within their budget.
+//Usage : test_tau2_stream_options
+namespace
+{
+
+bool check(const std::string& name, int value, int expected)
+{
+	std::cout << name << " : " << value << (value == expected ? "" : " (expected " + std::to_string(expected) + ")") << std::endl;
+	return value == expected;
+}
+
+} //namespace
+
+int main()
+{
+	const int payload_size = FTDI_PACKET_SIZE - FTDI_HEADER_SIZE;
+	bool success = true;
+
+	FTDIStreamOptions options;
+	FTDIStreamOptions_Default(&options);
+	options.adaptive = true;
+	options.minPacketsPerTransfer = 4;
+	options.maxPacketsPerTransfer = 64;
+	options.targetTransferTime = 0.002;
+
+	//Adaptive length, in bytes
+	success &= check("length at 0 B/s", FTDIStreamOptions_AdaptiveTransferLength(&options, 0), 4 * FTDI_PACKET_SIZE);
+	success &= check("length at 100 kB/s", FTDIStreamOptions_AdaptiveTransferLength(&options, 100e3), 4 * FTDI_PACKET_SIZE);
+	success &= check("length for 20 packets", FTDIStreamOptions_AdaptiveTransferLength(&options, 19.5 * payload_size / 0.002), 20 * FTDI_PACKET_SIZE);
+	success &= check("length at 20 MB/s (Tau2 640x512 at 30 Hz)", FTDIStreamOptions_AdaptiveTransferLength(&options, 20e6), 64 * FTDI_PACKET_SIZE);
+	success &= check("length at 1e30 B/s", FTDIStreamOptions_AdaptiveTransferLength(&options, 1e30), 64 * FTDI_PACKET_SIZE);
+
+	//Number of transfers queued, the buffers have to stay within the budget
+	options.numTransfers = 256;
+	success &= check("transfers of 64 packets", FTDIStreamOptions_NumTransfers(&options), FTDI_TRANSFER_POOL_SIZE / (64 * FTDI_PACKET_SIZE));
+	options.maxPacketsPerTransfer = 256;
+	success &= check("transfers of 256 packets", FTDIStreamOptions_NumTransfers(&options), FTDI_TRANSFER_POOL_SIZE / (256 * FTDI_PACKET_SIZE));
+	options.maxPacketsPerTransfer = 1 << 16;
+	success &= check("transfers above the budget", FTDIStreamOptions_NumTransfers(&options), FTDI_MIN_TRANSFERS);
+	options.maxPacketsPerTransfer = 64;
+	options.numTransfers = 8;
+	success &= check("transfers below the budget", FTDIStreamOptions_NumTransfers(&options), 8);
+
+	FTDIStreamOptions_Default(&options);//Fixed transfers of 8 packets : the whole budget
+	success &= check("default transfers", FTDIStreamOptions_NumTransfers(&options), 256);
+	options.adaptive = true;
+	success &= check("default adaptive pool size", FTDIStreamOptions_NumTransfers(&options) * options.maxPacketsPerTransfer * FTDI_PACKET_SIZE, FTDI_TRANSFER_POOL_SIZE);
+
+	std::cout << (success ? "Success" : "Failure") << std::endl;
+	return success ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+#include "tone_mapper.hpp"
+
+#include <opencv2/core/version.hpp>
+#if CV_MAJOR_VERSION == 2
+#include <opencv2/core/core.hpp>
+#elif CV_MAJOR_VERSION == 3
+#include <opencv2/core.hpp>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+
+//Compare each mode of the Tone_mapper with a scalar conversion written pixel by pixel, on known 16 bits images.
+//The images cover the paths of the vectorized statistics : continuous, rows with a tail shorter than a vector,
+//a non continuous ROI, a uniform image, and a large image whose sum does not fit in 32 bits.
+//The linear mode is also compared with convertTo, which it replaces.
+//Usage : test_tone_mapper
+namespace
+{
+
+//Deterministic values in [low, low + span[ (no dependency on the random generator of the platform)
+void fill_image(cv::Mat& img16, uint16_t low, uint32_t span, uint32_t seed)
+{
+	uint32_t state = seed;
+	for(int r = 0; r < img16.rows; ++r)
+	{
+		uint16_t* row = img16.ptr<uint16_t>(r);
+		for(int c = 0; c < img16.cols; ++c)
+		{
+			state = state * 1664525u + 1013904223u;
+			row[c] = static_cast<uint16_t>(low + (state >> 8) % span);
+		}
+	}
+	//A uniform band, as the sky in a thermal image, to make the plateau clip the histogram
+	for(int r = 0; r < img16.rows / 3; ++r)
+	{
+		std::fill(img16.ptr<uint16_t>(r), img16.ptr<uint16_t>(r) + img16.cols, low);
+	}
+}
+
+//Scalar version of each mode, without look-up table
+void reference(const cv::Mat& img16, cv::Mat& img8, cv::Mat& linear_ref, const cam::Tone_mapper& mapper)
+{
+	uint16_t min_value = 0xFFFF;
+	uint16_t max_value = 0;
+	uint64_t sum = 0;
+	std::map<uint16_t, uint64_t> histogram;
+	for(int r = 0; r < img16.rows; ++r)
+	{
+		const uint16_t* row = img16.ptr<uint16_t>(r);
+		for(int c = 0; c < img16.cols; ++c)
+		{
+			min_value = std::min(min_value, row[c]);
+			max_value = std::max(max_value, row[c]);
+			sum += row[c];
+			++histogram[row[c]];
+		}
+	}
+
+	const double mean = static_cast<double>(sum) / img16.total();
+	img16.convertTo(linear_ref, CV_8U, mapper.get_linear_gain(), 127 - mean * mapper.get_linear_gain());
+
+	//Cumulative distribution of the clipped histogram, for the equalization modes
+	const uint64_t bin_limit = mapper.get_mode() == cam::tone_plateau ? std::max<uint64_t>(1, static_cast<uint64_t>(mapper.get_plateau() * img16.total())) : UINT64_MAX;
+	std::map<uint16_t, uint64_t> cumulated;
+	uint64_t total = 0;
+	for(const std::pair<const uint16_t, uint64_t>& bin : histogram)
+	{
+		total += std::min(bin.second, bin_limit);
+		cumulated[bin.first] = total;
+	}
+	const uint64_t first = cumulated.begin()->second;
+
+	img8.create(img16.rows, img16.cols, CV_8UC1);
+	for(int r = 0; r < img16.rows; ++r)
+	{
+		const uint16_t* src = img16.ptr<uint16_t>(r);
+		uint8_t* dst = img8.ptr<uint8_t>(r);
+		for(int c = 0; c < img16.cols; ++c)
+		{
+			switch(mapper.get_mode())
+			{
+				case cam::tone_min_max:
+					dst[c] = max_value == min_value ? 127 : cv::saturate_cast<uint8_t>((src[c] - min_value) * (255.0f / (max_value - min_value)));
+					break;
+				case cam::tone_histogram:
+				case cam::tone_plateau:
+					dst[c] = total == first ? 127 : cv::saturate_cast<uint8_t>((cumulated[src[c]] - first) * (255.0f / (total - first)));
+					break;
+				case cam::tone_linear:
+				default:
+					dst[c] = linear_ref.ptr<uint8_t>(r)[c];
+					break;
+			}
+		}
+	}
+}
+
+int count_differences(const cv::Mat& a, const cv::Mat& b)
+{
+	if(a.rows != b.rows || a.cols != b.cols || a.type() != b.type()) return -1;
+	int differences = 0;
+	for(int r = 0; r < a.rows; ++r)
+	{
+		for(int c = 0; c < a.cols; ++c)
+		{
+			if(a.ptr<uint8_t>(r)[c] != b.ptr<uint8_t>(r)[c]) ++differences;
+		}
+	}
+	return differences;
+}
+
+} //namespace
+
+int main()
+{
+	cv::Mat full(512, 640, CV_16UC1);//Tau2 image
+	fill_image(full, 7000, 2000, 1);
+	cv::Mat odd(31, 37, CV_16UC1);//Rows of 4 vectors and a tail of 5 pixels
+	fill_image(odd, 100, 60000, 2);
+	cv::Mat uniform(16, 16, CV_16UC1);
+	fill_image(uniform, 8000, 1, 3);
+	cv::Mat large(1024, 1024, CV_16UC1);//Sum above 2^32, over several chunks of the vectorized sum
+	fill_image(large, 60000, 5536, 4);
+
+	struct Test_image { std::string name; cv::Mat img16; double linear_gain; };
+	const Test_image images[] = {
+		{"640x512", full, cam::tone_linear_gain_d},
+		{"37x31", odd, cam::tone_linear_gain_d},
+		{"ROI 301x200", full(cv::Rect(3, 50, 301, 200)), cam::tone_linear_gain_d},
+		{"uniform", uniform, cam::tone_linear_gain_d},
+		{"1024x1024", large, 1.0 / 1024},//Small gain : an error on the mean is visible in the output
+	};
+	const cam::Tone_mapping modes[] = {cam::tone_linear, cam::tone_min_max, cam::tone_histogram, cam::tone_plateau};
+	const char* mode_names[] = {"linear", "min_max", "histogram", "plateau"};
+
+	bool success = true;
+	cam::Tone_mapper mapper;//The same instance for all the images, as in the camera
+	cv::Mat img8, ref8, linear_ref;
+	for(const Test_image& test : images)
+	{
+		for(size_t m = 0; m < 4; ++m)
+		{
+			mapper.set_mode(modes[m]);
+			mapper.set_linear_gain(test.linear_gain);
+			mapper.apply(test.img16, img8);
+			reference(test.img16, ref8, linear_ref, mapper);
+
+			const int differences = count_differences(img8, ref8);
+			std::cout << test.name << ", " << mode_names[m] << " : " << differences << " pixels different from the reference";
+			if(modes[m] == cam::tone_linear)
+			{
+				const int convert_differences = count_differences(img8, linear_ref);
+				std::cout << ", " << convert_differences << " different from convertTo";
+				if(convert_differences != 0) success = false;
+			}
+			std::cout << std::endl;
+			if(differences != 0) success = false;
+		}
+	}
+
+	std::cout << (success ? "Success" : "Failure") << std::endl;
+	return success ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+#include "acquisition.hpp"
+
+#include "util_signal.hpp"
+
+#include "camera_synthetic.hpp"
+#include "trigger_loopback.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+//Multi-camera acquisition with synthetic cameras exposed on the pulses of a loopback trigger (no hardware needed).
+//A trigger is first sent for each set, then the trigger runs freely. In both modes, all the images of a set have to come
+//from the same pulse : same frame number in the image and same trigger time.
+//Usage : test_trigger_loopback [number of cameras] [free running period in us] [duration of each mode in s]
+namespace
+{
+
+struct Mode_result
+{
+	Mode_result() : sets(0), mismatches(0), unacknowledged(0) {}
+	unsigned int sets;
+	unsigned int mismatches;//Sets mixing several pulses
+	unsigned int unacknowledged;//Sets without trigger time
+};
+
+Mode_result run_mode(cam::Acquisition& acq, cam::SigHandler& sig_handle, int duration_s)
+{
+	Mode_result result;
+	cam::Frame_set_ptr frame_set;
+
+	const std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+	while(sig_handle.check_term_sig() && acq.is_running() && std::chrono::steady_clock::now() - start < std::chrono::seconds(duration_s))
+	{
+		if(acq.get_frames(frame_set) < 0) continue;
+		++result.sets;
+
+		uint64_t first_frame = 0;
+		std::memcpy(&first_frame, frame_set->images[0].ptr(0), sizeof(first_frame));
+		const int64_t first_trigger_us = frame_set->frame_info[0].trigger_device_us;
+		if(first_trigger_us < 0) ++result.unacknowledged;
+
+		for(size_t i = 1; i < frame_set->images.size(); ++i)
+		{
+			uint64_t frame = 0;
+			std::memcpy(&frame, frame_set->images[i].ptr(0), sizeof(frame));
+			if(frame != first_frame || frame_set->frame_info[i].trigger_device_us != first_trigger_us)
+			{
+				++result.mismatches;
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+} //namespace
+
+int main(int argc, char** argv)
+{
+	const int cam_number = argc > 1 ? std::stoi(argv[1]) : 3;
+	const uint32_t period_us = argc > 2 ? std::stoul(argv[2]) : 10000;
+	const int duration_s = argc > 3 ? std::stoi(argv[3]) : 2;
+
+	cam::SigHandler sig_handle;//Instantiate this class first since the constructor blocks the signal of all future child threads
+
+	std::shared_ptr<cam::Trigger_loopback> trigger = std::make_shared<cam::Trigger_loopback>();
+
+	cam::Acquisition acq;
+	for(int i = 0; i < cam_number; ++i)
+	{
+		acq.add_camera<cam::synthetic>("synthetic_" + std::to_string(i));
+		cam::SyntheticParameters& params = dynamic_cast<cam::SyntheticParameters&>(acq.get_cam_params(i));
+		params.set_image_format(752, 480, CV_8UC1);
+		params.set_latency(2000, 500, cam::latency_normal);
+		params.set_trigger(trigger);
+	}
+	acq.set_trigger(trigger);
+	acq.set_parallel_retrieval(true);
+
+	acq.start_acq();
+	const Mode_result triggered = run_mode(acq, sig_handle, duration_s);
+	acq.set_trigger_period_us(period_us);//Switched by the acquisition thread without stopping
+	const Mode_result free_running = run_mode(acq, sig_handle, duration_s);
+	acq.stop_acq();
+
+	std::cout << "mode, sets/s, sets mixing several pulses, sets without trigger time" << std::endl;
+	std::cout << "triggered, " << static_cast<double>(triggered.sets) / duration_s << ", " << triggered.mismatches << ", " << triggered.unacknowledged << std::endl;
+	std::cout << "free running (" << 1e6 / period_us << " Hz), " << static_cast<double>(free_running.sets) / duration_s << ", "
+			  << free_running.mismatches << ", " << free_running.unacknowledged << std::endl;
+	std::cout << "lost triggers : " << acq.get_lost_triggers() << std::endl;
+
+	const bool success = triggered.sets > 0 && free_running.sets > 0 && triggered.mismatches == 0 && free_running.mismatches == 0
+						 && triggered.unacknowledged == 0 && free_running.unacknowledged == 0;
+	std::cout << (success ? "Success" : "Failure") << std::endl;
+	return success ? 0 : 1;
+}
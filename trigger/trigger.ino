@@ -2,34 +2,147 @@
 const int pin_trigger = 9;//Pin to use for triggering
 const unsigned int high_time_us = 150;//Time the signal spend to high, microseconds
 
-void setup() 
+//Framed protocol with the host (see trigger.hpp) :
+//sync byte, message type, payload length, payload (little endian), XOR of the type, the length and the payload
+const byte sync_byte = 0xA5;
+const byte msg_trigger = 0x01;//Host : sequence id (2 bytes). One pulse, acknowledged.
+const byte msg_burst = 0x02;//Host : first sequence id (2 bytes), number of pulses (2 bytes, 0 until stopped), period in us (4 bytes). Each pulse is acknowledged.
+const byte msg_stop = 0x03;//Host : no payload. Stops the burst.
+const byte msg_ping = 0x04;//Host : sequence id (2 bytes). Answered by msg_pong without any pulse, to measure the latency of the link.
+const byte msg_ack = 0x81;//Device : sequence id (2 bytes), micros() at the start of the pulse (4 bytes)
+const byte msg_pong = 0x84;//Device : sequence id of the ping (2 bytes)
+const byte max_payload = 8;
+
+//Reception of the messages
+byte rx_state = 0;//0 : waiting for the sync byte, 1 : type, 2 : length, 3 : payload, 4 : checksum
+byte rx_type = 0;
+byte rx_length = 0;
+byte rx_count = 0;
+byte rx_checksum = 0;
+byte rx_payload[max_payload];
+
+//Burst in progress
+bool burst_running = false;
+unsigned int burst_seq = 0;//Sequence id of the next pulse
+unsigned int burst_remaining = 0;//Number of pulses left, 0 for a free run
+unsigned long burst_period_us = 0;
+unsigned long burst_next_us = 0;//micros() of the next pulse
+
+void setup()
 {
   pinMode(pin_trigger, OUTPUT);
   digitalWrite(pin_trigger,HIGH);
   Serial.begin(115200);
 }
 
-void send_trigger()
+unsigned long send_trigger()
 {
+  const unsigned long start_us = micros();
   digitalWrite(pin_trigger,LOW);
   delayMicroseconds(high_time_us);
   digitalWrite(pin_trigger,HIGH);
+  return start_us;
+}
+
+void send_message(byte type, const byte* payload, byte length)
+{
+  byte message[4 + max_payload];
+  message[0] = sync_byte;
+  message[1] = type;
+  message[2] = length;
+  byte checksum = type ^ length;
+  for(byte i = 0; i < length; i++)
+  {
+    message[3 + i] = payload[i];
+    checksum ^= payload[i];
+  }
+  message[3 + length] = checksum;
+
+  Serial.write(message, 4 + length);
+}
+
+void send_ack(unsigned int seq, unsigned long time_us)
+{
+  byte payload[6];
+  payload[0] = seq & 0xFF;
+  payload[1] = seq >> 8;
+  for(byte i = 0; i < 4; i++) payload[2 + i] = (time_us >> (8 * i)) & 0xFF;
+  send_message(msg_ack, payload, sizeof(payload));
+}
+
+unsigned long read_u32(const byte* data)
+{
+  return (unsigned long)data[0] | ((unsigned long)data[1] << 8) | ((unsigned long)data[2] << 16) | ((unsigned long)data[3] << 24);
+}
+
+void process_message()
+{
+  if(rx_type == msg_trigger && rx_length == 2)
+  {
+    const unsigned int seq = rx_payload[0] | (rx_payload[1] << 8);
+    send_ack(seq, send_trigger());
+  }
+  else if(rx_type == msg_burst && rx_length == 8)
+  {
+    burst_seq = rx_payload[0] | (rx_payload[1] << 8);
+    burst_remaining = rx_payload[2] | (rx_payload[3] << 8);
+    burst_period_us = read_u32(&rx_payload[4]);
+    burst_next_us = micros();
+    burst_running = burst_period_us > high_time_us;
+  }
+  else if(rx_type == msg_stop)
+  {
+    burst_running = false;
+  }
+  else if(rx_type == msg_ping && rx_length == 2)
+  {
+    send_message(msg_pong, rx_payload, 2);
+  }
 }
 
-void loop() 
+void receive_byte(byte incoming_byte)
 {
-  if(Serial.available() > 0)
+  switch(rx_state)
   {
-    int incoming_byte = Serial.read();
-    if(incoming_byte == 1)
-    {
-      send_trigger();
-      Serial.write(0xFF);
-    }
+    case 0:
+      if(incoming_byte == sync_byte) rx_state = 1;
+      break;
+    case 1:
+      rx_type = incoming_byte;
+      rx_checksum = incoming_byte;
+      rx_state = 2;
+      break;
+    case 2:
+      rx_length = incoming_byte;
+      rx_checksum ^= incoming_byte;
+      rx_count = 0;
+      if(rx_length > max_payload) rx_state = 0;//Not a valid message
+      else rx_state = rx_length > 0 ? 3 : 4;
+      break;
+    case 3:
+      rx_payload[rx_count++] = incoming_byte;
+      rx_checksum ^= incoming_byte;
+      if(rx_count == rx_length) rx_state = 4;
+      break;
+    default:
+      if(incoming_byte == rx_checksum) process_message();//A corrupted message is dropped, the host sees the missing ack
+      rx_state = 0;
+      break;
   }
+}
 
-/*  send_trigger();
-  Serial.write(0xff);
-  delay(63);*/
+void loop()
+{
+  while(Serial.available() > 0)
+  {
+    receive_byte(Serial.read());
+  }
 
+  //The pulses of a burst are scheduled from the first one, so that the period does not drift
+  if(burst_running && (long)(micros() - burst_next_us) >= 0)
+  {
+    send_ack(burst_seq++, send_trigger());
+    burst_next_us += burst_period_us;
+    if(burst_remaining > 0 && --burst_remaining == 0) burst_running = false;
+  }
 }